@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "Division.cpp"
+
+// Division by one fixed n-limb N: the divisor is normalized and its reciprocal
+// floor(B^(2n) / (N << shift)) computed once, after which every remainder of a value below
+// N * B^n costs two products. Same residue interface as MontgomeryContext without the
+// Montgomery form, so it serves any N, even ones included.
+class BarrettContext {
+public:
+    BarrettContext(const Limb* modulus, size_t n) : mod(modulus, modulus + mpn::normalizedSize(modulus, n)) {
+        if (mod.empty()) {
+            throw std::runtime_error("Division by zero");
+        }
+        size_t size = mod.size();
+        shift = mpn::countLeadingZeros(mod.back());
+        norm.resize(size);
+        if (shift != 0) mpn::lshift(norm.data(), mod.data(), size, shift);
+        else norm = mod;
+        inverse.resize(size + 1);
+        mpn::invert(inverse.data(), norm.data(), size);
+        unit.assign(size, 0);
+        unit[0] = size > 1 || mod[0] > 1 ? 1 : 0;
+    }
+
+    // from any contiguous limb container: LimbBuffer, LimbVector, BigInt::magnitude()
+    template <class Limbs>
+    explicit BarrettContext(const Limbs& modulus) : BarrettContext(modulus.data(), modulus.size()) {
+    }
+
+    size_t size() const { return mod.size(); }
+    size_t scratchSize() const { return 7 * mod.size(); }
+    const Limb* modulus() const { return mod.data(); }
+    const Limb* one() const { return unit.data(); }
+
+    // r = a * b mod N; a, b < N, r may alias either input
+    void mul(Limb* r, const Limb* a, const Limb* b, Limb* scratch) const {
+        size_t n = mod.size();
+        Limb* u = scratch;
+        mpn::mul(u, a, n, b, n);
+        reduceProduct(r, u, scratch + 2 * n);
+    }
+
+    void sqr(Limb* r, const Limb* a, Limb* scratch) const {
+        mul(r, a, a, scratch);
+    }
+
+    // q[0 .. an-n] = a / N, r[0 .. n) = a % N for an >= n
+    void divRem(Limb* q, Limb* r, const Limb* a, size_t an) const {
+        if (mod.size() == 1) {
+            r[0] = mpn::divRem1(q, a, an, mod[0]);
+            return;
+        }
+        mpn::divRemPreinverted(q, r, a, an, norm.data(), shift, inverse.data(), mod.size());
+    }
+
+    // r[0 .. n) = a % N for any an
+    void reduce(Limb* r, const Limb* a, size_t an) const {
+        size_t n = mod.size();
+        an = mpn::normalizedSize(a, an);
+        if (an < n) {
+            std::copy(a, a + an, r);
+            std::fill(r + an, r + n, 0);
+            return;
+        }
+        LimbBuffer q(an - n + 1);
+        divRem(q.data(), r, a, an);
+    }
+
+private:
+    LimbBuffer mod;
+    LimbBuffer norm;                            // mod << shift, top bit set
+    LimbBuffer inverse;                         // floor(B^(2n) / norm), n + 1 limbs
+    LimbBuffer unit;
+    unsigned shift;
+
+    // r = u mod N for u = a * b < N^2 in u[0 .. 2n), which is overwritten. Shifted by the
+    // normalization, u stays below norm * B^n, so one reduction step covers it.
+    void reduceProduct(Limb* r, Limb* u, Limb* scratch) const {
+        size_t n = mod.size();
+        if (n == 1) {                           // one hardware division beats two products
+            mpn::divWide(u[1], u[0], mod[0], r[0]);
+            return;
+        }
+        if (shift != 0) mpn::lshift(u, u, 2 * n, shift);
+        mpn::divide2n1nPreinverted(scratch, u, norm.data(), inverse.data(), n, scratch + n);
+        if (shift != 0) mpn::rshift(r, u, n, shift);
+        else std::copy(u, u + n, r);
+    }
+};
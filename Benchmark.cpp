@@ -0,0 +1,389 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "BigInt.cpp"
+#include "FixedBase.cpp"
+
+// Timing harness, built as its own executable:
+//   Benchmark [--max-bits N] [--min-time MS] [--ops add,mul,...] [--json FILE]
+//             [--compare FILE] [--tolerance PCT] [--fit]
+// Every operation runs over operand sizes 64, 256, 1024, ... bits up to --max-bits (capped per
+// operation where the algorithm is superlinear) and reports ns/op and limbs/sec. --json writes
+// one result per line, --compare reads such a file and flags results slower by more than
+// --tolerance percent, exiting with 1 if any are. --fit times the algorithms on each side of
+// every crossover and prints the -D settings that match this machine.
+
+namespace bench {
+
+    struct Options {
+        size_t maxBits = size_t(1) << 20;
+        double minSeconds = 0.05;
+        std::vector<std::string> ops;
+        std::string json;
+        std::string compare;
+        double tolerance = 10;
+        bool fit = false;
+    };
+
+    struct Result {
+        std::string op;
+        size_t bits;
+        size_t limbs;
+        size_t iterations;
+        double nsPerOp;
+        double limbsPerSec;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    template <class F>
+    double timeBatch(F& f, size_t batch) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < batch; ++i) f();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Doubles the batch until it takes minSeconds, then returns the best seconds per call of
+    // that batch and two more, which filters out most scheduling noise.
+    template <class F>
+    double timeOp(F f, double minSeconds, size_t& iterations) {
+        size_t batch = 1;
+        double elapsed;
+        while ((elapsed = timeBatch(f, batch)) < minSeconds && batch < (size_t(1) << 30)) batch *= 2;
+        for (int i = 0; i < 2; ++i) elapsed = std::min(elapsed, timeBatch(f, batch));
+        iterations = batch;
+        return elapsed / batch;
+    }
+
+    // splitmix64, so every run and every version times the same operands
+    inline Limb nextRandom(Limb& state) {
+        Limb z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Random value below 2^bits, built by halves so large sizes stay cheap.
+    inline BigInt randomBelow(size_t bits, Limb& state) {
+        if (bits <= 62) return BigInt((long long)(nextRandom(state) >> (64 - bits)));
+        size_t low = bits / 2;
+        BigInt lowPart = randomBelow(low, state);
+        return (randomBelow(bits - low, state) << int(low)) | lowPart;
+    }
+
+    // Random value of exactly `bits` bits
+    inline BigInt randomBits(size_t bits, Limb& state) {
+        return randomBelow(bits, state) | (BigInt::one() << int(bits - 1));
+    }
+
+    inline BigInt randomOdd(size_t bits, Limb& state) {
+        BigInt x = randomBits(bits, state);
+        return x.testBit(0) ? x : x + BigInt::one();
+    }
+
+    // Keeps the optimiser from dropping a result it can see is unused.
+    inline void consume(const BigInt& x) {
+        static volatile size_t sink;
+        sink = sink + x.bitLength();
+    }
+
+    struct Operation {
+        const char* name;
+        size_t maxBits;
+    };
+
+    // Largest operand size per operation; quadratic and cubic algorithms stop early.
+    const Operation OPERATIONS[] = {
+        { "add", size_t(1) << 26 },
+        { "sub", size_t(1) << 26 },
+        { "mul", size_t(1) << 26 },
+        { "karatsuba", size_t(1) << 26 },
+        { "div", size_t(1) << 24 },
+        { "mod", size_t(1) << 24 },
+        { "barrett", size_t(1) << 24 },
+        { "gcd", size_t(1) << 18 },
+        { "extendedGCD", size_t(1) << 16 },
+        { "shl", size_t(1) << 26 },
+        { "shr", size_t(1) << 26 },
+        { "binaryPower", size_t(1) << 24 },
+        { "quaryPower", size_t(1) << 24 },
+        { "quaryPowerCached", size_t(1) << 24 },
+        { "powMod", size_t(1) << 13 },
+        { "multiPowMod", size_t(1) << 13 },
+        { "fixedBasePowMod", size_t(1) << 13 },
+        { "montgomeryProd", size_t(1) << 16 },
+        { "nextPrime", size_t(1) << 11 },
+    };
+
+    // Seconds per call of operation `op` on `bits`-bit operands.
+    inline double runOp(const std::string& op, size_t bits, double minSeconds, size_t& iterations) {
+        Limb state = bits;
+        BigInt a = randomBits(bits, state);
+        BigInt b = randomBits(bits, state);
+        if (op == "add") return timeOp([&] { consume(a + b); }, minSeconds, iterations);
+        if (op == "sub") return timeOp([&] { consume(a - b); }, minSeconds, iterations);
+        if (op == "mul") return timeOp([&] { consume(a * b); }, minSeconds, iterations);
+        if (op == "karatsuba") return timeOp([&] { consume(a.karatsuba(a, b)); }, minSeconds, iterations);
+        if (op == "gcd") return timeOp([&] { consume(a.GCD(b)); }, minSeconds, iterations);
+        if (op == "extendedGCD") {
+            return timeOp([&] { consume(a.extendedGCD(a, b).first); }, minSeconds, iterations);
+        }
+        if (op == "shl") return timeOp([&] { consume(a << 37); }, minSeconds, iterations);
+        if (op == "shr") return timeOp([&] { consume(a >> 37); }, minSeconds, iterations);
+        if (op == "nextPrime") return timeOp([&] { consume(a.nextPrime()); }, minSeconds, iterations);
+
+        // 2n-bit dividend over an n-bit divisor
+        BigInt dividend = a * b + randomBits(bits / 2 + 1, state);
+        if (op == "div") return timeOp([&] { consume((dividend / a).first); }, minSeconds, iterations);
+        if (op == "mod") return timeOp([&] { consume(dividend % a); }, minSeconds, iterations);
+        if (op == "barrett") {
+            BarrettContext ctx(a.magnitude());
+            return timeOp([&] { consume(dividend.reduce(ctx)); }, minSeconds, iterations);
+        }
+
+        // bits/16-bit base to the 16th, so the result has about `bits` bits
+        BigInt base = randomBits(std::max<size_t>(bits / 16, 2), state);
+        if (op == "binaryPower") {
+            BigInt sixteen(16);
+            return timeOp([&] { consume(base.binaryPower(sixteen)); }, minSeconds, iterations);
+        }
+        // 16 = 4^2 is a cache hit after the first call, so the cold row clears it every time
+        if (op == "quaryPower") {
+            return timeOp([&] { BigInt::clearPowerCache(); consume(base.quaryPower(16, 4)); }, minSeconds, iterations);
+        }
+        if (op == "quaryPowerCached") return timeOp([&] { consume(base.quaryPower(16, 4)); }, minSeconds, iterations);
+
+        BigInt m = randomOdd(bits, state);
+        if (op == "powMod") return timeOp([&] { consume(a.powMod(a, b, m)); }, minSeconds, iterations);
+        if (op == "multiPowMod") {
+            return timeOp([&] { consume(BigInt::multiPowMod(a, b, b, a, m)); }, minSeconds, iterations);
+        }
+        if (op == "fixedBasePowMod") {
+            FixedBasePowMod fixedBase(a, m, bits);
+            return timeOp([&] { consume(fixedBase.pow(b)); }, minSeconds, iterations);
+        }
+        if (op == "montgomeryProd") {
+            BigInt pinv, r, r2;
+            return timeOp([&] { consume(a.montgomeryProd(a, b, m, pinv, r, r2)); }, minSeconds, iterations);
+        }
+        throw std::runtime_error("Unknown operation " + op);
+    }
+
+    inline bool selected(const Options& options, const std::string& op) {
+        return options.ops.empty() || std::find(options.ops.begin(), options.ops.end(), op) != options.ops.end();
+    }
+
+    inline std::vector<Result> runSweep(const Options& options) {
+        std::vector<Result> results;
+        std::cout << "operation            bits      ns/op         limbs/sec" << std::endl;
+        for (const Operation& operation : OPERATIONS) {
+            if (!selected(options, operation.name)) continue;
+            for (size_t bits = 64; bits <= std::min(options.maxBits, operation.maxBits); bits *= 4) {
+                Result result;
+                result.op = operation.name;
+                result.bits = bits;
+                result.limbs = (bits + mpn::LIMB_BITS - 1) / mpn::LIMB_BITS;
+                double seconds = runOp(result.op, bits, options.minSeconds, result.iterations);
+                result.nsPerOp = seconds * 1e9;
+                result.limbsPerSec = result.limbs / seconds;
+                results.push_back(result);
+
+                char line[128];
+                snprintf(line, sizeof(line), "%-16s %10zu %12.0f %16.4g", operation.name, bits,
+                    result.nsPerOp, result.limbsPerSec);
+                std::cout << line << std::endl;
+            }
+        }
+        return results;
+    }
+
+    inline void writeJson(const std::string& path, const std::vector<Result>& results) {
+        std::ofstream out(path);
+        if (!out) throw std::runtime_error("Cannot write " + path);
+        out << "{\"kernels\": \"" << mpn::kernels().name << "\", \"threads\": " << mpn::parallelThreads()
+            << ", \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            char line[256];
+            snprintf(line, sizeof(line),
+                "{\"op\": \"%s\", \"bits\": %zu, \"limbs\": %zu, \"iterations\": %zu, \"ns_per_op\": %.1f, \"limbs_per_sec\": %.6g}",
+                r.op.c_str(), r.bits, r.limbs, r.iterations, r.nsPerOp, r.limbsPerSec);
+            out << line << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+    }
+
+    // The text following `"key": ` on a line of writeJson output, or null.
+    inline const char* field(const std::string& line, const char* key) {
+        size_t at = line.find(std::string("\"") + key + "\": ");
+        return at == std::string::npos ? nullptr : line.c_str() + at + std::strlen(key) + 4;
+    }
+
+    // Reads back the one-result-per-line files writeJson produces.
+    inline std::vector<Result> readJson(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) throw std::runtime_error("Cannot read " + path);
+        std::vector<Result> results;
+        std::string line;
+        while (std::getline(in, line)) {
+            const char* op = field(line, "op");
+            if (op == nullptr || *op != '"' || field(line, "limbs_per_sec") == nullptr) continue;
+            Result r;
+            r.op.assign(op + 1, std::strchr(op + 1, '"'));
+            r.bits = std::strtoull(field(line, "bits"), nullptr, 10);
+            r.limbs = std::strtoull(field(line, "limbs"), nullptr, 10);
+            r.iterations = std::strtoull(field(line, "iterations"), nullptr, 10);
+            r.nsPerOp = std::strtod(field(line, "ns_per_op"), nullptr);
+            r.limbsPerSec = std::strtod(field(line, "limbs_per_sec"), nullptr);
+            results.push_back(r);
+        }
+        return results;
+    }
+
+    // Prints new/old time for every result in both runs; returns the number of regressions.
+    inline size_t compareResults(const std::vector<Result>& current, const std::vector<Result>& baseline, double tolerance) {
+        size_t regressions = 0;
+        std::cout << "operation            bits   baseline ns    current ns   ratio" << std::endl;
+        for (const Result& now : current) {
+            for (const Result& old : baseline) {
+                if (old.op != now.op || old.bits != now.bits) continue;
+                double ratio = now.nsPerOp / old.nsPerOp;
+                bool regressed = ratio > 1 + tolerance / 100;
+                regressions += regressed;
+                char line[160];
+                snprintf(line, sizeof(line), "%-16s %10zu %13.0f %13.0f %7.3f%s", now.op.c_str(), now.bits,
+                    old.nsPerOp, now.nsPerOp, ratio, regressed ? "  REGRESSION" : "");
+                std::cout << line << std::endl;
+            }
+        }
+        return regressions;
+    }
+
+    // Smallest n of the sweep at which `fast` beats `slow` and keeps winning at the next two
+    // sizes, or 0 if that never happens.
+    template <class Slow, class Fast>
+    size_t crossover(const std::vector<size_t>& sizes, Slow slow, Fast fast, double minSeconds) {
+        std::vector<bool> wins;
+        for (size_t n : sizes) {
+            size_t iterations;
+            double tSlow = timeOp([&] { slow(n); }, minSeconds, iterations);
+            double tFast = timeOp([&] { fast(n); }, minSeconds, iterations);
+            wins.push_back(tFast < tSlow);
+        }
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            size_t end = std::min(i + 3, sizes.size());
+            if (std::find(wins.begin() + i, wins.begin() + end, false) == wins.begin() + end) return sizes[i];
+        }
+        return 0;
+    }
+
+    inline std::vector<size_t> sizeRange(size_t from, size_t to, double step) {
+        std::vector<size_t> sizes;
+        for (double n = double(from); n <= double(to); n *= step) {
+            if (sizes.empty() || size_t(n) != sizes.back()) sizes.push_back(size_t(n));
+        }
+        return sizes;
+    }
+
+    inline void reportFit(const char* macro, size_t current, size_t fitted) {
+        std::cout << "-D" << macro << "=";
+        if (fitted == 0) std::cout << "(no crossover in range)";
+        else std::cout << fitted;
+        std::cout << "    currently " << current << std::endl;
+    }
+
+    // Times the algorithm below and above each threshold head to head at the top level, with
+    // the recursion underneath using the thresholds this binary was built with.
+    inline void fitThresholds(double minSeconds) {
+        Limb state = 1;
+        size_t maxN = 1 << 16;
+        std::vector<Limb> a(2 * maxN), b(maxN), r(4 * maxN), q(2 * maxN);
+        for (Limb& x : a) x = nextRandom(state);
+        for (Limb& x : b) x = nextRandom(state);
+        b[maxN - 1] |= Limb(1) << 63;
+        std::vector<Limb> scratch(8 * maxN + 64 * 64);
+
+        std::vector<size_t> small = sizeRange(1, 64, 1.25);
+        size_t kernel = crossover(small,
+            [&](size_t n) { mpn::generic::addMul1(r.data(), a.data(), n, b[0]); },
+            [&](size_t n) { mpn::kernels().addMul1(r.data(), a.data(), n, b[0]); }, minSeconds);
+        reportFit("BIGINT_KERNEL_THRESHOLD", BIGINT_KERNEL_THRESHOLD, kernel);
+
+        size_t karatsuba = crossover(sizeRange(4, 256, 1.2),
+            [&](size_t n) { mpn::mulBasecase(r.data(), a.data(), n, b.data(), n); },
+            [&](size_t n) { mpn::mulKaratsuba(r.data(), a.data(), b.data(), n, scratch.data()); }, minSeconds);
+        reportFit("BIGINT_KARATSUBA_THRESHOLD", BIGINT_KARATSUBA_THRESHOLD, karatsuba);
+
+        size_t toom3 = crossover(sizeRange(16, 1024, 1.2),
+            [&](size_t n) { mpn::mulKaratsuba(r.data(), a.data(), b.data(), n, scratch.data()); },
+            [&](size_t n) { mpn::mulToom3(r.data(), a.data(), b.data(), n, scratch.data()); }, minSeconds);
+        reportFit("BIGINT_TOOM3_THRESHOLD", BIGINT_TOOM3_THRESHOLD, toom3);
+
+        size_t ntt = crossover(sizeRange(512, maxN, 1.41),
+            [&](size_t n) { mpn::mulToom3(r.data(), a.data(), b.data(), n, scratch.data()); },
+            [&](size_t n) { mpn::mulNtt(r.data(), a.data(), n, b.data(), n); }, minSeconds);
+        reportFit("BIGINT_NTT_THRESHOLD", BIGINT_NTT_THRESHOLD, ntt);
+
+        // 2n-limb dividend over the top n limbs of b, which are normalized
+        size_t divide = crossover(sizeRange(8, 1024, 1.2),
+            [&](size_t n) { mpn::divRemBasecase(q.data(), r.data(), a.data(), 2 * n, b.data() + maxN - n, n); },
+            [&](size_t n) { mpn::divRemDivideAndConquer(q.data(), r.data(), a.data(), 2 * n, b.data() + maxN - n, n); },
+            minSeconds);
+        reportFit("BIGINT_DIV_DC_THRESHOLD", BIGINT_DIV_DC_THRESHOLD, divide);
+
+        size_t newton = crossover(sizeRange(2048, maxN, 1.41),
+            [&](size_t n) { mpn::divRemDivideAndConquer(q.data(), r.data(), a.data(), 2 * n, b.data() + maxN - n, n); },
+            [&](size_t n) { mpn::divRemNewton(q.data(), r.data(), a.data(), 2 * n, b.data() + maxN - n, n); },
+            minSeconds);
+        reportFit("BIGINT_DIV_NEWTON_THRESHOLD", BIGINT_DIV_NEWTON_THRESHOLD, newton);
+    }
+
+    inline Options parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--fit") options.fit = true;
+            else if (arg == "--max-bits" && hasValue) options.maxBits = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--min-time" && hasValue) options.minSeconds = std::atof(argv[++i]) / 1000;
+            else if (arg == "--json" && hasValue) options.json = argv[++i];
+            else if (arg == "--compare" && hasValue) options.compare = argv[++i];
+            else if (arg == "--tolerance" && hasValue) options.tolerance = std::atof(argv[++i]);
+            else if (arg == "--ops" && hasValue) {
+                std::stringstream list(argv[++i]);
+                std::string op;
+                while (std::getline(list, op, ',')) options.ops.push_back(op);
+            }
+            else throw std::runtime_error("Unknown argument " + arg);
+        }
+        return options;
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        bench::Options options = bench::parseOptions(argc, argv);
+        std::cout << "kernels: " << mpn::kernels().name << ", threads: " << mpn::parallelThreads() << std::endl;
+        if (options.fit) {
+            bench::fitThresholds(options.minSeconds);
+            if (options.ops.empty() && options.json.empty() && options.compare.empty()) return 0;
+        }
+        std::vector<bench::Result> results = bench::runSweep(options);
+        if (!options.json.empty()) bench::writeJson(options.json, results);
+        if (!options.compare.empty()) {
+            std::vector<bench::Result> baseline = bench::readJson(options.compare);
+            if (bench::compareResults(results, baseline, options.tolerance) != 0) return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -1,234 +1,514 @@
-﻿#include <iostream>
+﻿#pragma once
+#include <iostream>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <string>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+#include <memory>
+#include <atomic>
+#include <random>
+#include <limits>
+#include "Limbs.cpp"
+#include "LimbVector.cpp"
+#include "Multiplication.cpp"
+#include "Division.cpp"
+#include "Decimal.cpp"
+#include "Montgomery.cpp"
+#include "Bitwise.cpp"
+#include "PowMod.cpp"
+#include "Prime.cpp"
+#include "GCD.cpp"
+#include "Serialization.cpp"
+#include "DecimalStream.cpp"
+
+// quaryPower keeps the powers base^(q^i) of its last base per thread while they total at
+// most this many limbs.
+#ifndef BIGINT_POWER_CACHE_LIMBS
+#define BIGINT_POWER_CACHE_LIMBS (size_t(1) << 20)
+#endif
 
 class BigInt {
 private:
-    std::vector<int> digits;
+    LimbVector limbs;
     bool positive;
+
+    friend class LazyEvaluator;
+    friend class FixedBasePowMod;
 public:
 
     BigInt() : positive(true) {
     }
 
+    explicit BigInt(long long value) : positive(value >= 0) {
+        unsigned long long magnitude = value >= 0 ? value : 0 - (unsigned long long)value;
+        if (magnitude != 0) limbs.push_back(magnitude);
+    }
+
+    // Shared constants, so hot loops do not parse literals.
+    static const BigInt& zero() {
+        static const BigInt value;
+        return value;
+    }
+
+    static const BigInt& one() {
+        static const BigInt value(1);
+        return value;
+    }
+
+    static const BigInt& two() {
+        static const BigInt value(2);
+        return value;
+    }
+
+    // Threads the arithmetic may use for products above BIGINT_PARALLEL_THRESHOLD limbs:
+    // 1 (the default) keeps it on the calling thread, 0 uses every hardware thread.
+    static void setMaxThreads(unsigned threads) {
+        mpn::setParallelThreads(threads);
+    }
+
     void print() const {
-        if (!positive) std::cout << "-";
-        for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
-            std::cout << *it;
+        writeDecimal(std::cout);
+    }
+
+    // Streams the decimal form out in blocks instead of building the whole string.
+    void writeDecimal(std::ostream& out) const {
+        writeDecimal([&out](const char* text, size_t len) { out.write(text, std::streamsize(len)); });
+    }
+
+    // sink(const char*, size_t) receives the text in order, a block at a time.
+    template <class Sink, class = typename std::enable_if<!std::is_base_of<std::ios_base, Sink>::value>::type>
+    void writeDecimal(Sink sink) const {
+        BIGINT_PROBE(ToString, limbs.size());
+        mpn::BlockWriter<Sink> writer(sink);
+        if (!positive) writer.fill('-', 1);
+        mpn::writeDecimal(writer, limbs.data(), limbs.size(), 0);
+        writer.flush();
+    }
+
+    // Parses a whole stream as one decimal number, optionally signed and surrounded by
+    // whitespace, reading it in fixed-size chunks.
+    static BigInt readDecimal(std::istream& in) {
+        return readDecimal([&in](char* buffer, size_t size) {
+            in.read(buffer, std::streamsize(size));
+            return size_t(in.gcount());
+        });
+    }
+
+    // read(char* buffer, size_t size) fills up to size chars and returns how many, 0 at the
+    // end, so a file descriptor can be wrapped as [fd](char* b, size_t n) { return ::read(fd, b, n); }.
+    template <class Read, class = typename std::enable_if<!std::is_base_of<std::ios_base, Read>::value>::type>
+    static BigInt readDecimal(Read read) {
+        BIGINT_PROBE(Parse, 0);
+        mpn::DecimalReader reader;
+        std::vector<char> buffer(mpn::STREAM_WRITE_CHARS);
+        for (;;) {
+            size_t got = size_t(read(buffer.data(), buffer.size()));
+            if (got == 0) break;
+            reader.feed(buffer.data(), got);
         }
+        BigInt result;
+        bool negative;
+        reader.finish(result.limbs, negative);
+        result.positive = !negative;
+        return result;
+    }
+
+    std::string toString() const {
+        std::string str(maxDecimalLength(), '\0');
+        str.resize(toChars(&str[0], &str[0] + str.size()) - str.data());
+        return str;
+    }
+
+    // Upper bound on the characters toChars writes, sign included.
+    size_t maxDecimalLength() const {
+        return mpn::maxDecimalDigits(limbs.size()) + 1;
     }
 
-    BigInt(const std::string& numStr) {
-        positive = (numStr[0] != '-');
-        digits.clear();
-        for (int i = (numStr[0] == '-' ? 1 : 0); i < numStr.size(); ++i) {
-            digits.push_back(numStr[i] - '0');
+    // Writes the decimal form into [first, last) without a terminator and returns the end of
+    // the written text; throws if it does not fit.
+    char* toChars(char* first, char* last) const {
+        BIGINT_PROBE(ToString, limbs.size());
+        size_t room = size_t(last - first);
+        if (room < maxDecimalLength()) {
+            std::string str = toString();
+            if (str.size() > room) {
+                throw std::runtime_error("Buffer too small");
+            }
+            return std::copy(str.begin(), str.end(), first);
         }
-        std::reverse(digits.begin(), digits.end());
+        if (!positive) *first++ = '-';
+        return mpn::formatDecimal(first, limbs.data(), limbs.size(), 0);
+    }
+
+    BigInt(const std::string& numStr) : positive(true) {
+        size_t start = (!numStr.empty() && numStr[0] == '-') ? 1 : 0;
+        parseDecimal(numStr.data() + start, numStr.size() - start);
+        positive = (start == 0);
         removeLeadingZeros();
     }
+    // Bitwise operators treat negative values as infinite two's complement, like Python and GMP.
     BigInt operator&(const BigInt& other) const {
-        BigInt result;
-        BigInt a = *this;
-        BigInt b = other;
-        int maxlen = std::max(other.digits.size(), digits.size());
-        while (a.digits.size() != maxlen) {
-            a.digits.push_back(0);
-        }
-        while (b.digits.size() != maxlen) {
-            b.digits.push_back(0);
-        }
-        for (int i = 0; i < maxlen; i++) {
-            result.digits.push_back(a.digits[i] & b.digits[i]);
-        }
-        result.digits = this->digits;
-        result.positive = this->positive && other.positive;
+        return bitwise(other, mpn::AndOp());
+    }
+
+    BigInt operator|(const BigInt& other) const {
+        return bitwise(other, mpn::OrOp());
+    }
+
+    BigInt operator^(const BigInt& other) const {
+        return bitwise(other, mpn::XorOp());
+    }
 
+    // ~x == -x - 1
+    BigInt operator~() const {
+        BigInt result = *this + one();
+        if (!result.limbs.empty()) result.positive = !result.positive;
         return result;
     }
+
+    BigInt& operator&=(const BigInt& other) {
+        return *this = *this & other;
+    }
+
+    BigInt& operator|=(const BigInt& other) {
+        return *this = *this | other;
+    }
+
+    BigInt& operator^=(const BigInt& other) {
+        return *this = *this ^ other;
+    }
+
+    // Bit `bit` of the two's-complement form, so testBit agrees with & and |.
+    bool testBit(size_t bit) const {
+        size_t word = bit / mpn::LIMB_BITS;
+        if (word >= limbs.size()) return !positive;
+        bool set = mpn::testBit(limbs.data(), bit);
+        if (positive) return set;
+        // -m flips every bit above the lowest set bit of m
+        size_t lowest = 0;
+        while (limbs[lowest] == 0) ++lowest;
+        lowest = lowest * mpn::LIMB_BITS + mpn::countTrailingZeros(limbs[lowest]);
+        return bit <= lowest ? set : !set;
+    }
+
+    // Bits in |x|; zero has length 0.
+    size_t bitLength() const {
+        return mpn::bitLength(limbs.data(), limbs.size());
+    }
+
+    // Set bits in |x|.
+    size_t popCount() const {
+        return mpn::popCount(limbs.data(), limbs.size());
+    }
+
     bool operator==(const BigInt& other) const {
-        return digits == other.digits && positive == other.positive;
+        return limbs == other.limbs && positive == other.positive;
     }
     bool operator!=(const BigInt& other) const {
         return !(*this == other);
     }
     bool operator<=(const BigInt& other) const {
-        if (positive && !other.positive) return false;
-        if (!positive && other.positive) return true;
-        if (*this == other) return true;
-        if (positive) return !absoluteIsGreaterThan(other);
-        else return absoluteIsGreaterThan(other);
+        return !(*this > other);
     }
     bool operator>=(const BigInt& other) const {
-        bool t2 = *this <= other;
-        return !(*this <= other);
+        return !(*this < other);
     }
 
     BigInt operator+(const BigInt& other) const {
+        BIGINT_PROBE(Add, limbs.size() + other.limbs.size());
         if (positive == other.positive) {
             BigInt result = addAbsolute(other);
             result.positive = positive;
+            result.removeLeadingZeros();
             return result;
         }
         else {
             if (absoluteIsGreaterThan(other)) {
                 BigInt result = subtractAbsolute(other);
                 result.positive = positive;
+                result.removeLeadingZeros();
                 return result;
             }
             else {
                 BigInt result = other.subtractAbsolute(*this);
                 result.positive = other.positive;
+                result.removeLeadingZeros();
                 return result;
             }
         }
     }
 
     BigInt operator-(const BigInt& other) const {
+        BIGINT_PROBE(Subtract, limbs.size() + other.limbs.size());
         if (positive == other.positive) {
             if (absoluteIsGreaterThan(other)) {
                 BigInt result = subtractAbsolute(other);
                 result.positive = positive;
+                result.removeLeadingZeros();
                 return result;
             }
             else {
                 BigInt result = other.subtractAbsolute(*this);
                 result.positive = !positive;
+                result.removeLeadingZeros();
                 return result;
             }
         }
         else {
             BigInt result = addAbsolute(other);
             result.positive = positive;
+            result.removeLeadingZeros();
             return result;
         }
     }
 
     std::pair<BigInt, BigInt> operator/(const BigInt& divisor) const {
-        BigInt x = *this;
-        BigInt y = divisor;
-        x.positive = true;
-        y.positive = true;
-        std::pair<BigInt,BigInt> result = x.divideWithRemainder(y);
+        std::pair<BigInt,BigInt> result = divideWithRemainder(divisor);
         result.first.positive = this->positive == divisor.positive;
         result.second.positive = this->positive == divisor.positive;
-        if (result.first == BigInt("-0") or result.first == BigInt("0")) {
-            result.first.positive = true;
-        }
-        if (result.second == BigInt("-0") or result.second == BigInt("0")) {
-            result.second.positive = true;
-        }
+        result.first.removeLeadingZeros();
+        result.second.removeLeadingZeros();
         return result;
     }
 
     BigInt operator%(const BigInt& divisor) const {
-        BigInt x = *this;
-        BigInt y = divisor;
-        x.positive = true;
-        y.positive = true;
-        BigInt result = x.divideWithRemainder(y).second;
+        BigInt result = divideWithRemainder(divisor).second;
         result.positive = this->positive == divisor.positive;
+        result.removeLeadingZeros();
         return result;
     }
 
     BigInt operator<<(int shift) const {
+        BIGINT_PROBE(Shift, limbs.size());
         if (shift < 0) {
             throw std::runtime_error("Negative shift");
         }
-        if (shift == 0) {
+        if (shift == 0 || limbs.empty()) {
             return *this;
         }
-        BigInt multiplier("2");
-        for (int i = 0; i < shift-1; i++) {
-            multiplier = multiplier * BigInt("2");
-        }
+        size_t limbShift = shift / mpn::LIMB_BITS;
+        unsigned bitShift = shift % mpn::LIMB_BITS;
         BigInt result;
-        BigInt carry ("0");
-        for(size_t i = 0; i < digits.size(); i++) {
-            BigInt temp = BigInt(std::to_string(digits[i]));
-            temp = temp * multiplier;
-            BigInt sum = carry + BigInt(std::to_string(digits[i])) * multiplier;
-            BigInt add = sum % BigInt("10");
-            result.digits.push_back(add.digits[0]);
-            if (sum >= BigInt("10")) {
-                carry = (sum/BigInt("10")).first;
-            }
-            else {
-                carry = BigInt("0");
-            }
+        result.limbs.assign(limbs.size() + limbShift + 1, 0);
+        if (bitShift == 0) {
+            std::copy(limbs.begin(), limbs.end(), result.limbs.begin() + limbShift);
         }
-        if (carry != BigInt("0")) {
-            for (int i = 0; i < carry.digits.size(); i++) {
-                result.digits.push_back(carry.digits[i]);
-            }
+        else {
+            result.limbs.back() = mpn::lshift(&result.limbs[limbShift], limbs.data(), limbs.size(), bitShift);
         }
         result.positive = positive;
+        result.removeLeadingZeros();
         return result;
     }
-    
+
     BigInt operator>>(int shift) const {
+        BIGINT_PROBE(Shift, limbs.size());
         if (shift < 0) {
             throw std::runtime_error("Negative shift");
         }
         BigInt result;
         result.positive = positive;
-        int divisor = pow(2, shift);
-        int carry = 0;
-        int quotient = 0;
-        int carry2 = 0;
-        for (int i = digits.size() - 1; i >= 0; i--) {     
-            if (i != 0) {
-                int temp1 = digits[i];
-                int temp2 = carry * 10;
-                quotient = quotient * 10 + digits[i] + carry * 10;
-                if (quotient < divisor) {
-                    result.digits.push_back(0);
-                    continue;
-                }
-                result.digits.push_back(quotient / divisor);
-                carry = quotient % divisor;
-                quotient = 0;
-            }
-            else {
-                quotient = (quotient * 10 + digits[i] + carry * 10) / divisor;
-                result.digits.push_back(quotient);
-            }
+        size_t limbShift = shift / mpn::LIMB_BITS;
+        unsigned bitShift = shift % mpn::LIMB_BITS;
+        if (limbShift >= limbs.size()) {
+            return BigInt();
+        }
+        result.limbs.assign(limbs.begin() + limbShift, limbs.end());
+        if (bitShift != 0) {
+            mpn::rshift(result.limbs.data(), result.limbs.data(), result.limbs.size(), bitShift);
         }
-        std::reverse(result.digits.begin(), result.digits.end());
         result.removeLeadingZeros();
         return result;
     }
 
     BigInt operator*(const BigInt& other) const {
+        BIGINT_PROBE(Multiply, limbs.size() + other.limbs.size());
         BigInt result;
-        result.digits.resize(digits.size() + other.digits.size(), 0);
-
-        for (size_t i = 0; i < digits.size(); ++i) {
-            int carry = 0;                         
-            for (size_t j = 0; j < other.digits.size() || carry; ++j) {
-                long long cur = result.digits[i + j] + (digits[i]) * (j < other.digits.size() ? other.digits[j] : 0) + carry;
-                result.digits[i + j] = cur % 10;
-                carry = cur / 10;
-            }
+        if (limbs.empty() || other.limbs.empty()) {
+            return result;
         }
-        result.removeLeadingZeros();
+        result.limbs.resize(limbs.size() + other.limbs.size(), 0);
+        mpn::mul(result.limbs.data(), limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
         result.positive = positive == other.positive;
+        result.removeLeadingZeros();
         return result;
     }
 
     BigInt& operator=(const BigInt& other) {
         if (this != &other) {
-            digits.clear();
-            digits = other.digits;
+            limbs = other.limbs;
             positive = other.positive;
         }
         return *this;
     }
 
+    BigInt(const BigInt& other) : limbs(other.limbs), positive(other.positive) {
+    }
+
+    // The moved-from value is left as zero.
+    BigInt(BigInt&& other) noexcept : limbs(std::move(other.limbs)), positive(other.positive) {
+        other.positive = true;
+    }
+
+    BigInt& operator=(BigInt&& other) noexcept {
+        if (this != &other) {
+            limbs = std::move(other.limbs);
+            positive = other.positive;
+            other.limbs.clear();
+            other.positive = true;
+        }
+        return *this;
+    }
+
+    // Compound assignment works on the existing limbs and only grows them when needed.
+    BigInt& operator+=(const BigInt& other) {
+        BIGINT_PROBE(Add, limbs.size() + other.limbs.size());
+        if (this == &other) {
+            return *this <<= 1;
+        }
+        addSigned(other.limbs.data(), other.limbs.size(), other.positive);
+        return *this;
+    }
+
+    BigInt& operator-=(const BigInt& other) {
+        BIGINT_PROBE(Subtract, limbs.size() + other.limbs.size());
+        if (this == &other) {
+            limbs.clear();
+            positive = true;
+            return *this;
+        }
+        addSigned(other.limbs.data(), other.limbs.size(), !other.positive);
+        return *this;
+    }
+
+    BigInt& operator*=(const BigInt& other) {
+        BIGINT_PROBE(Multiply, limbs.size() + other.limbs.size());
+        if (limbs.empty() || other.limbs.empty()) {
+            limbs.clear();
+            positive = true;
+            return *this;
+        }
+        positive = positive == other.positive;
+        if (other.limbs.size() == 1) {
+            Limb carry = mpn::mul1(limbs.data(), limbs.data(), limbs.size(), other.limbs[0]);
+            if (carry) limbs.push_back(carry);
+            return *this;
+        }
+        LimbVector product(limbs.size() + other.limbs.size(), 0);
+        mpn::mul(product.data(), limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
+        limbs.swap(product);
+        removeLeadingZeros();
+        return *this;
+    }
+
+    BigInt& operator%=(const BigInt& other) {
+        bool sign = positive == other.positive;
+        *this = divideWithRemainder(other).second;
+        positive = sign;
+        removeLeadingZeros();
+        return *this;
+    }
+
+    BigInt& operator<<=(int shift) {
+        BIGINT_PROBE(Shift, limbs.size());
+        if (shift < 0) {
+            throw std::runtime_error("Negative shift");
+        }
+        if (shift == 0 || limbs.empty()) {
+            return *this;
+        }
+        size_t n = limbs.size();
+        size_t limbShift = shift / mpn::LIMB_BITS;
+        unsigned bitShift = shift % mpn::LIMB_BITS;
+        limbs.resize(n + limbShift + 1);
+        if (bitShift == 0) {
+            std::copy_backward(limbs.begin(), limbs.begin() + n, limbs.begin() + n + limbShift);
+            limbs[n + limbShift] = 0;
+        }
+        else {
+            limbs[n + limbShift] = mpn::lshift(limbs.data() + limbShift, limbs.data(), n, bitShift);
+        }
+        std::fill(limbs.begin(), limbs.begin() + limbShift, 0);
+        removeLeadingZeros();
+        return *this;
+    }
+
+    BigInt& operator>>=(int shift) {
+        BIGINT_PROBE(Shift, limbs.size());
+        if (shift < 0) {
+            throw std::runtime_error("Negative shift");
+        }
+        size_t limbShift = shift / mpn::LIMB_BITS;
+        unsigned bitShift = shift % mpn::LIMB_BITS;
+        if (limbShift >= limbs.size()) {
+            limbs.clear();
+            positive = true;
+            return *this;
+        }
+        size_t n = limbs.size() - limbShift;
+        if (bitShift != 0) {
+            mpn::rshift(limbs.data(), limbs.data() + limbShift, n, bitShift);
+        }
+        else if (limbShift != 0) {
+            std::copy(limbs.begin() + limbShift, limbs.end(), limbs.begin());
+        }
+        limbs.resize(n);
+        removeLeadingZeros();
+        return *this;
+    }
+
+    // Temporaries on either side lend their limbs to the result.
+    friend BigInt operator+(BigInt&& a, const BigInt& b) {
+        a += b;
+        return std::move(a);
+    }
+
+    friend BigInt operator+(const BigInt& a, BigInt&& b) {
+        b += a;
+        return std::move(b);
+    }
+
+    friend BigInt operator+(BigInt&& a, BigInt&& b) {
+        a += b;
+        return std::move(a);
+    }
+
+    friend BigInt operator-(BigInt&& a, const BigInt& b) {
+        a -= b;
+        return std::move(a);
+    }
+
+    friend BigInt operator-(const BigInt& a, BigInt&& b) {
+        b -= a;
+        if (!b.limbs.empty()) b.positive = !b.positive;
+        return std::move(b);
+    }
+
+    friend BigInt operator-(BigInt&& a, BigInt&& b) {
+        a -= b;
+        return std::move(a);
+    }
+
+    friend BigInt operator*(BigInt&& a, const BigInt& b) {
+        a *= b;
+        return std::move(a);
+    }
+
+    friend BigInt operator*(const BigInt& a, BigInt&& b) {
+        b *= a;
+        return std::move(b);
+    }
+
+    friend BigInt operator*(BigInt&& a, BigInt&& b) {
+        a *= b;
+        return std::move(a);
+    }
+
     bool operator<(const BigInt& other) const {
-        return !(*this > other);
+        return other > *this;
     }
 
     bool operator>(const BigInt& other) const {
@@ -244,297 +524,1152 @@ public:
     }
 
     BigInt(const std::vector<int>& numVec) : positive(true) {
-        digits = numVec;
-        removeLeadingZeros();
+        assignDecimalDigits(numVec.begin(), numVec.end());
     }
 
+    // this^exponent; past one limb of exponent only 0, 1 and -1 have a representable power.
     BigInt binaryPower(const BigInt& exponent) const {
-        if (exponent != BigInt("0") && exponent <= BigInt("0")) {
-            throw std::runtime_error("Negative exponent not supported");
+        checkExponent(exponent);
+        if (exponent.limbs.size() > 1) {
+            if (limbs.size() > 1 || (limbs.size() == 1 && limbs[0] != 1)) {
+                throw std::runtime_error("Power too large");
+            }
+            BigInt result = limbs.empty() ? BigInt() : one();
+            result.positive = positive || !exponent.testBit(0);
+            return result;
         }
+        return power(exponent.limbs.empty() ? 0 : exponent.limbs[0]);
+    }
 
-        BigInt result("1");
-        BigInt base(*this);
-        BigInt exp(exponent);
+    // this^exponent for a word exponent. The factor 2^t of the base becomes one shift by
+    // t * exponent at the end, and the odd part goes through windowPower.
+    BigInt power(Limb exponent) const {
+        BIGINT_PROBE(Power, limbs.size() + 1);
+        if (exponent == 0) return one();
+        if (limbs.empty()) return BigInt();
+        size_t zeros = trailingZeroBits();
+        if (zeros != 0 && exponent > Limb(std::numeric_limits<int>::max()) / zeros) {
+            throw std::runtime_error("Power too large");
+        }
+        BigInt odd = fromLimbs(limbs.data(), limbs.size());
+        if (zeros != 0) odd >>= int(zeros);
+        BigInt result = odd.windowPower(exponent);
+        if (zeros != 0) result <<= int(zeros * exponent);
+        result.positive = positive || (exponent & 1) == 0;
+        return result;
+    }
 
-        while (exp != BigInt("0") and exp >= BigInt("0")) {
-            if (exp % BigInt("2") == BigInt("1")) {
-                result = result * base;  
+    // floor(sqrt(this)) and this - root^2; throws for a negative value.
+    std::pair<BigInt, BigInt> isqrtRem() const {
+        if (!positive) {
+            throw std::runtime_error("Square root of a negative number");
+        }
+        return irootRem(2);
+    }
+
+    BigInt isqrt() const {
+        return isqrtRem().first;
+    }
+
+    // The k-th root truncated toward zero and this - root^k, which has the sign of this.
+    // Negative values need an odd k.
+    std::pair<BigInt, BigInt> irootRem(unsigned k) const {
+        BIGINT_PROBE(Root, limbs.size());
+        if (k == 0) {
+            throw std::runtime_error("Root of degree zero");
+        }
+        if (!positive && k % 2 == 0) {
+            throw std::runtime_error("Even root of a negative number");
+        }
+        std::pair<BigInt, BigInt> root = rootMagnitude(fromLimbs(limbs.data(), limbs.size()), k);
+        root.first.positive = root.second.positive = positive;
+        root.first.removeLeadingZeros();
+        root.second.removeLeadingZeros();
+        return root;
+    }
+
+    BigInt iroot(unsigned k) const {
+        return irootRem(k).first;
+    }
+
+    // Whether this = b^e for some integer b and e >= 2.
+    bool isPerfectPower() const {
+        BigInt base;
+        unsigned exponent;
+        return isPerfectPower(base, exponent);
+    }
+
+    // Also gives the b of least magnitude, with its exponent; 0 and 1 report exponent 2 and
+    // -1 exponent 3. Only prime exponents are tried; a hit restarts the search on the root
+    // from the same exponent, since the root cannot be a power of any smaller one.
+    bool isPerfectPower(BigInt& base, unsigned& exponent) const {
+        base = *this;
+        exponent = 1;
+        if (limbs.size() <= 1 && (limbs.empty() || limbs[0] == 1)) {
+            exponent = positive ? 2 : 3;
+            return true;
+        }
+        BigInt m = fromLimbs(limbs.data(), limbs.size());
+        BigInt root;
+        for (unsigned p = 2; (p = m.leastPowerPrime(p, !positive, root)) != 0;) {
+            m = std::move(root);
+            exponent *= p;
+        }
+        base = m;
+        base.positive = positive;
+        return exponent > 1;
+    }
+
+    // Baillie-PSW: trial division by the small primes, a strong test to base 2 and a strong
+    // Lucas test, plus `rounds` Miller-Rabin rounds to bases drawn from the value itself, so
+    // the answer is reproducible. No composite is known to pass; values below 2 fail. The
+    // Lucas test and the extra rounds share one MontgomeryContext and run as tasks on the
+    // threads allowed by setMaxThreads.
+    bool isProbablePrime(unsigned rounds = 0) const {
+        BIGINT_PROBE(Prime, limbs.size());
+        if (!positive || limbs.empty()) return false;
+        if ((limbs[0] & 1) == 0) return limbs.size() == 1 && limbs[0] == 2;
+        Limb limit = mpn::trialDivisionLimit(bitLength());
+        if (limbs.size() == 1 && limbs[0] < limit) {
+            const LimbBuffer& primes = mpn::smallPrimes();
+            return std::binary_search(primes.begin(), primes.end(), limbs[0]);
+        }
+        if (mpn::smallFactor(limbs.data(), limbs.size(), limit) != 0) return false;
+        if (limbs.size() == 1 && limbs[0] / limit < limit) return true;
+        return isProbablePrimeOdd(rounds);
+    }
+
+    // The least prime above this. Odd candidates are sieved a window at a time by the small
+    // primes, from single-word remainders computed once per window, and only the survivors
+    // get the full test.
+    BigInt nextPrime(unsigned rounds = 0) const {
+        BIGINT_PROBE(Prime, limbs.size());
+        if (!positive || *this < two()) return two();
+        BigInt candidate = *this + (limbs[0] & 1 ? two() : one());
+        while (candidate.limbs.size() == 1 && candidate.limbs[0] < BIGINT_PRIME_SIEVE_BOUND) {
+            if (candidate.isProbablePrime(rounds)) return candidate;
+            candidate += two();
+        }
+        LimbBuffer residues(mpn::smallPrimes().size());
+        std::vector<char> marks(std::max<size_t>(candidate.bitLength(), 64));
+        for (;;) {
+            size_t count = mpn::smallPrimeResidues(residues.data(), candidate.limbs.data(), candidate.limbs.size(),
+                BIGINT_PRIME_SIEVE_BOUND);
+            mpn::sieveOdd(marks, residues.data(), count);
+            for (size_t i = 0; i < marks.size(); ++i) {
+                if (marks[i]) continue;
+                BigInt c = candidate + BigInt((long long)(2 * i));
+                if (c.isProbablePrimeOdd(rounds)) return c;
             }
-            base = base * base; 
-            exp = exp >> 1;
+            candidate += BigInt((long long)(2 * marks.size()));
         }
+    }
 
-        return result;
+    // A uniformly chosen bits-bit start, then the next prime after it, retried until that
+    // prime still has bits bits. rng is any uniform random bit generator.
+    template <class Rng>
+    static BigInt randomPrime(size_t bits, Rng& rng, unsigned rounds = 0) {
+        if (bits < 2) {
+            throw std::runtime_error("A prime has at least 2 bits");
+        }
+        std::uniform_int_distribution<Limb> word;
+        for (;;) {
+            BigInt start;
+            start.limbs.resize((bits + mpn::LIMB_BITS - 1) / mpn::LIMB_BITS);
+            for (Limb& limb : start.limbs) limb = word(rng);
+            unsigned top = unsigned((bits - 1) % mpn::LIMB_BITS);
+            start.limbs.back() &= top == 63 ? ~Limb(0) : (Limb(1) << (top + 1)) - 1;
+            start.limbs.back() |= Limb(1) << top;
+            BigInt prime = (start - one()).nextPrime(rounds);
+            if (prime.bitLength() == bits) return prime;
+        }
     }
 
+    // The exponents i of y^i summing to x, largest first and repeated as the base-y digits
+    // of x say.
     std::vector<int> powerExpansion(int x, int y) const {
-        std::vector<int> powers;
-        while (x > 0) {
-            int power = 0;
-            while (pow(y, power) <= x) {
-                power++;
-            }
-            power--;
-            powers.push_back(power);
-            x -= pow(y, power);
+        if (y < 2) {
+            throw std::runtime_error("Power base q must be at least 2");
         }
+        std::vector<int> powers;
+        std::vector<int> digits = radixDigits(x, y);
+        for (size_t i = digits.size(); i-- > 0;) powers.insert(powers.end(), digits[i], int(i));
         return powers;
     }
 
+    // this^power with power = d q^j + rest, d q^j its top base-q digit. The powers this^(q^i)
+    // of the odd part are cached per thread for the last base and q, and when d = 1 and rest
+    // is at most power / 8, this^(q^j) comes from the cache and only this^rest is computed.
+    // Otherwise the product of terms costs more than the squarings it saves, so the power is
+    // computed directly. The base's factor of two is one shift.
     BigInt quaryPower(const int& power, const int& q) const {
-        std::vector<int> ps = powerExpansion(power, q);
-        std::vector<BigInt> bi;
-        BigInt result("1");
-        for (int i = 0; i < ps.size(); i++) {
-            int p = pow(q, ps[i]);
-            result = result * this->binaryPower(BigInt(std::to_string(p)));
+        BIGINT_PROBE(Power, limbs.size() + 1);
+        if (power < 0) {
+            throw std::runtime_error("Negative exponent not supported");
+        }
+        if (q < 2) {
+            throw std::runtime_error("Power base q must be at least 2");
         }
+        if (power == 0) return one();
+        if (limbs.empty()) return BigInt();
+        size_t zeros = trailingZeroBits();
+        if (zeros != 0 && size_t(power) > size_t(std::numeric_limits<int>::max()) / zeros) {
+            throw std::runtime_error("Power too large");
+        }
+        BigInt odd = fromLimbs(limbs.data(), limbs.size());
+        if (zeros != 0) odd >>= int(zeros);
+
+        std::vector<int> digits = radixDigits(power, q);
+        int top = digits.back();
+        int scale = 1;                          // q^j
+        for (size_t i = 1; i < digits.size(); ++i) scale *= q;
+        int rest = power - top * scale;
+        BigInt result;
+        if (top != 1 || rest > power / 8) {
+            result = odd.windowPower(Limb(power));
+        }
+        else {
+            struct PowerCache {
+                BigInt base;
+                int q = 0;
+                unsigned generation = 0;
+                std::vector<BigInt> powers;     // base^(q^i)
+            };
+            static thread_local PowerCache cache;
+            if (cache.generation != powerCacheGeneration() || cache.q != q || cache.base != odd) {
+                cache.base = odd;
+                cache.q = q;
+                cache.generation = powerCacheGeneration();
+                cache.powers.assign(1, odd);
+            }
+            while (cache.powers.size() < digits.size()) {
+                cache.powers.push_back(cache.powers.back().windowPower(Limb(q)));
+            }
+            result = cache.powers[digits.size() - 1] * odd.windowPower(Limb(rest));
+            size_t cached = 0;
+            for (const BigInt& p : cache.powers) cached += p.limbs.size();
+            if (cached > BIGINT_POWER_CACHE_LIMBS) cache = PowerCache();
+        }
+        if (zeros != 0) result <<= int(zeros * size_t(power));
+        result.positive = positive || (power & 1) == 0;
         return result;
     }
+
+    // Invalidates quaryPower's cache on the calling thread: the next call starts cold and
+    // releases the cached powers.
+    static void clearPowerCache() {
+        ++powerCacheGeneration();
+    }
+
     bool operator>(const int& other) const {
-        BigInt num(std::to_string(other));
+        BigInt num(other);
         return *this > num;
     }
-    BigInt operator|(const BigInt& other) const {
-        BigInt result;
-        size_t maxSize = std::max(digits.size(), other.digits.size());
-        std::vector<int> a(digits);
-        std::vector<int> b(other.digits);
-        a.resize(maxSize, 0);
-        b.resize(maxSize, 0);
-        for (size_t i = 0; i < maxSize; ++i) {
-            result.digits.push_back(a[i] | b[i]);
+    // Lehmer's algorithm, finishing with binary GCD once the operands fit in a word.
+    BigInt GCD(const BigInt& other) const {
+        BIGINT_PROBE(Gcd, limbs.size() + other.limbs.size());
+        if (limbs.empty() || other.limbs.empty()) {
+            BigInt result = limbs.empty() ? other : *this;
+            result.positive = true;
+            return result;
         }
-        result.removeLeadingZeros();
-        result.positive = positive || other.positive;
-
+        BigInt result;
+        result.limbs.resize(std::max(limbs.size(), other.limbs.size()));
+        result.limbs.resize(mpn::gcd(result.limbs.data(), limbs.data(), limbs.size(),
+            other.limbs.data(), other.limbs.size()));
         return result;
     }
-    // https://scienceland.info/algebra8/euclid-algorithm
-    BigInt GCD(const BigInt& other) const {
-        BigInt a = *this;
-        a.positive = true;
-        BigInt b = other;
-        b.positive = true;
-        while (b != BigInt("0")) {
-            BigInt temp = b;
-            b = a % b;
-            a = temp;
+
+    // For non-negative a, b: (d, x, y) with a*x + b*y = d = gcd(a, b), the coefficients
+    // Euclid's algorithm on (b, a) ends with, computed by Lehmer's algorithm. A negative input
+    // keeps the legacy result of that recurrence under operator/'s sign convention: the triple
+    // does not satisfy a*x + b*y = d, and d may be negative.
+    std::pair<BigInt, std::pair<BigInt, BigInt>> extendedGCD(const BigInt& a, const BigInt& b) {
+        BIGINT_PROBE(ExtendedGcd, a.limbs.size() + b.limbs.size());
+        if (a.limbs.empty()) {
+            return std::make_pair(b, std::make_pair(zero(), one()));
         }
-        return a;
+        if (!a.positive || !b.positive) {
+            return extendedGCDSigned(a, b);
+        }
+        BigInt x;
+        BigInt d = gcdCofactor(a, b, x);
+        BigInt y = b.limbs.empty() ? zero() : ((d - a * x) / b).first;
+        return std::make_pair(d, std::make_pair(x, y));
     }
-    std::pair<BigInt, std::pair<BigInt, BigInt>> extendedGCD(const BigInt& a, const BigInt& b) {
-        BigInt x("1");
-        BigInt y("1");
-        return extGCD(a, b, x, y);
+
+    // x in [0, m) with this * x = 1 (mod m)
+    BigInt modInverse(const BigInt& m) const {
+        BIGINT_PROBE(ModInverse, limbs.size() + m.limbs.size());
+        if (m.limbs.empty() || !m.positive) {
+            throw std::runtime_error("Modulus must be positive");
+        }
+        LimbBuffer r = residue(m.limbs.data(), m.limbs.size());
+        BigInt x;
+        BigInt d = gcdCofactor(fromLimbs(r.data(), r.size()), m, x);
+        if (d != one()) {
+            throw std::runtime_error("Not invertible");
+        }
+        if (!x.positive) {
+            x += m;
+        }
+        return x;
     }
 
     BigInt(std::vector<int>::const_iterator begin, std::vector<int>::const_iterator end) : positive(true) {
-        digits.assign(begin, end);
+        assignDecimalDigits(begin, end);
     }
     BigInt increasing_Discharge(BigInt& num, size_t n) {
+        BigInt ten(10);
         for (size_t i = 0; i < n; ++i) {
-            num.digits.insert(num.digits.begin(), 0);
+            num *= ten;
         }
         return num;
     }
+    // operator* switches to Karatsuba (and Toom-3) on its own above BIGINT_KARATSUBA_THRESHOLD limbs.
     BigInt karatsuba(BigInt& X, BigInt& Y) {
+        return X * Y;
+    }
+
+    // this^(base + 1) mod mod, the value the original repeated-multiplication loop produced
+    BigInt myPow(BigInt base, BigInt mod) {
+        return powMod(*this, base + one(), mod);
+    }
+
+    // a^e mod |m| in [0, |m|): sliding window over Montgomery products for odd m,
+    // over Barrett reduction for even m.
+    BigInt powMod(const BigInt& a, const BigInt& e, const BigInt& m) const {
+        checkExponent(e);
+        if (m.limbs.empty()) {
+            throw std::runtime_error("Division by zero");
+        }
+        if (m.limbs[0] & 1) {
+            return a.powMod(e, MontgomeryContext(m.limbs));
+        }
+        BIGINT_PROBE(PowMod, m.limbs.size() + e.limbs.size());
+        return a.powMod(e, BarrettContext(m.limbs));
+    }
 
-        if (X.digits[0] < 4 && Y.digits[0] < 4)
-            return X * Y;
+    // this^e mod N for any N, with a Barrett context built once for many exponentiations
+    BigInt powMod(const BigInt& e, const BarrettContext& ctx) const {
+        BIGINT_PROBE(PowMod, ctx.size() + e.limbs.size());
+        checkExponent(e);
+        LimbBuffer b = residue(ctx);
+        LimbBuffer r(ctx.size());
+        mpn::powModSlidingWindow(r.data(), b.data(), e.limbs.data(), e.limbs.size(), ctx);
+        return fromLimbs(r.data(), r.size());
+    }
 
-        long long size = fmax(X.digits.size(), Y.digits.size()); 
-        if (size < 10)   
-            return X * Y;
+    // *this mod N in [0, N): two products per N-sized block of *this instead of a division
+    BigInt reduce(const BarrettContext& ctx) const {
+        LimbBuffer r = residue(ctx);
+        return fromLimbs(r.data(), r.size());
+    }
 
-        size = (size / 2) + (size % 2);
-        BigInt Size(std::to_string(size));
-        BigInt multiplier = increasing_Discharge(multiplier, size);
-        BigInt b = (X / multiplier).first;
-        BigInt a = X - (b * multiplier);
-        BigInt d = (Y / multiplier).first;
-        BigInt c = Y - (d * Size);
-        BigInt temp1 = a + b;
-        BigInt temp2 = c + d;
-        BigInt u = karatsuba(a, c);
-        BigInt z = karatsuba(temp1, temp2);
-        BigInt v = karatsuba(b, d);
-        return u + ((z - u - v) * multiplier) + increasing_Discharge(v, 2 * size);
+    // this^e mod N with a context built once for many exponentiations
+    BigInt powMod(const BigInt& e, const MontgomeryContext& ctx) const {
+        BIGINT_PROBE(PowMod, ctx.size() + e.limbs.size());
+        checkExponent(e);
+        LimbBuffer b = residue(ctx);
+        LimbBuffer r(ctx.size());
+        LimbBuffer scratch(ctx.scratchSize());
+        ctx.toMontgomery(b.data(), b.data(), scratch.data());
+        mpn::powModSlidingWindow(r.data(), b.data(), e.limbs.data(), e.limbs.size(), ctx);
+        ctx.fromMontgomery(r.data(), r.data(), scratch.data());
+        return fromLimbs(r.data(), r.size());
     }
 
-    BigInt myPow(BigInt base, BigInt mod) {
-        BigInt temp = *this;
-        for (BigInt i = BigInt("0"); i < base; i = i + BigInt("1")) {
-            temp = temp * (*this);
-            while (temp >= mod) {
-                temp = temp - mod;
+    // results[i] = bases[i]^exponents[i] mod |moduli[i]| for i < count, into a preallocated
+    // array. Tuples with equal moduli share one context, and the work is spread over the
+    // threads allowed by setMaxThreads.
+    static void powModBatch(const BigInt* bases, const BigInt* exponents, const BigInt* moduli,
+        BigInt* results, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            checkExponent(exponents[i]);
+            if (moduli[i].limbs.empty()) {
+                throw std::runtime_error("Division by zero");
             }
         }
-        while (temp >= mod) {
-            temp = temp - mod;
+        std::vector<size_t> order(count);
+        for (size_t i = 0; i < count; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [moduli](size_t x, size_t y) {
+            return moduli[y].absoluteIsGreaterThan(moduli[x]);
+        });
+
+        std::vector<std::unique_ptr<MontgomeryContext>> contexts;
+        std::vector<std::unique_ptr<BarrettContext>> evenContexts;
+        std::vector<size_t> groups;
+        for (size_t i = 0; i < count; ++i) {
+            const BigInt& m = moduli[order[i]];
+            if (i == 0 || m.limbs != moduli[order[i - 1]].limbs) {
+                bool odd = (m.limbs[0] & 1) != 0;
+                groups.push_back(i);
+                contexts.emplace_back(odd ? new MontgomeryContext(m.limbs) : nullptr);
+                evenContexts.emplace_back(odd ? nullptr : new BarrettContext(m.limbs));
+            }
         }
-        return temp;
-    }
-    BigInt powMod(BigInt a, BigInt e, BigInt m) {
-        BigInt r("1");
-        while (e > 0) {
-            if ((e & BigInt("1")) == BigInt("1")) {
-                r = (r * a) % m;
+        groups.push_back(count);
+
+        mpn::TaskGroup tasks(mpn::parallelPool(batchWork(exponents, moduli, count)));
+        for (size_t g = 0; g + 1 < groups.size(); ++g) {
+            const size_t* group = &order[groups[g]];
+            size_t size = groups[g + 1] - groups[g];
+            if (contexts[g]) {
+                powModGroup(bases, exponents, group, size, *contexts[g], results, tasks);
+                continue;
+            }
+            const BarrettContext& ctx = *evenContexts[g];
+            for (size_t i = 0; i < size; ++i) {
+                size_t k = group[i];
+                tasks.run([=, &ctx] { results[k] = bases[k].powMod(exponents[k], ctx); });
             }
-            e = e >> 1;
-            a = (a * a) % m;
         }
-        return r;
+        tasks.wait();
+    }
+
+    // results[i] = bases[i]^exponents[i] mod N for i < count, all with the one context
+    static void powModBatch(const BigInt* bases, const BigInt* exponents, const MontgomeryContext& ctx,
+        BigInt* results, size_t count) {
+        for (size_t i = 0; i < count; ++i) checkExponent(exponents[i]);
+        std::vector<size_t> order(count);
+        for (size_t i = 0; i < count; ++i) order[i] = i;
+        size_t work = 0;
+        for (size_t i = 0; i < count; ++i) work += ctx.size() * std::max<size_t>(exponents[i].limbs.size(), 1);
+        mpn::TaskGroup tasks(mpn::parallelPool(work));
+        powModGroup(bases, exponents, order.data(), count, ctx, results, tasks);
+        tasks.wait();
     }
 
+    // bases[0]^exponents[0] * ... * bases[count-1]^exponents[count-1] mod |m| with one shared
+    // run of squarings: Straus's interleaved windows for a few terms, Pippenger's buckets for
+    // many.
+    static BigInt multiPowMod(const BigInt* bases, const BigInt* exponents, size_t count, const BigInt& m) {
+        for (size_t i = 0; i < count; ++i) checkExponent(exponents[i]);
+        if (m.limbs.empty()) {
+            throw std::runtime_error("Division by zero");
+        }
+        if (m.limbs[0] & 1) {
+            return multiPowMod(bases, exponents, count, MontgomeryContext(m.limbs));
+        }
+        return multiPowMod(bases, exponents, count, BarrettContext(m.limbs));
+    }
+
+    // g^a * h^b mod |m|, the shape of a signature check
+    static BigInt multiPowMod(const BigInt& g, const BigInt& a, const BigInt& h, const BigInt& b, const BigInt& m) {
+        const BigInt bases[2] = { g, h };
+        const BigInt exponents[2] = { a, b };
+        return multiPowMod(bases, exponents, 2, m);
+    }
+
+    // Same value as powMod for odd m, but with fixed 4-bit windows and masked table lookups:
+    // the work done depends only on the limb counts of e and m, not on their bits.
+    BigInt powModConstantTime(const BigInt& a, const BigInt& e, const BigInt& m) const {
+        BIGINT_PROBE(PowMod, m.limbs.size() + e.limbs.size());
+        checkExponent(e);
+        MontgomeryContext ctx(m.limbs);
+        LimbBuffer b = a.residue(ctx);
+        LimbBuffer r(ctx.size());
+        LimbBuffer scratch(ctx.scratchSize());
+        ctx.toMontgomery(b.data(), b.data(), scratch.data());
+        mpn::powModFixedWindow(r.data(), b.data(), e.limbs.data(), e.limbs.size(), ctx);
+        ctx.fromMontgomery(r.data(), r.data(), scratch.data());
+        return fromLimbs(r.data(), r.size());
+    }
+
+    // a * b mod P through a MontgomeryContext; Pinv, r and r2 receive n' = -P^-1 mod 2^64,
+    // R = 2^(64 * limbs of P) and R^2 mod P.
     BigInt montgomeryProd(BigInt& a, BigInt& b, BigInt& P, BigInt& Pinv, BigInt& r, BigInt& r2) {
-        BigInt two("2");
-        BigInt degree("64");
+        MontgomeryContext ctx(P.limbs);
+        Pinv.limbs.assign(1, ctx.n0());
+        Pinv.positive = true;
+        Pinv.removeLeadingZeros();
+        r.limbs.assign(ctx.size() + 1, 0);
+        r.limbs.back() = 1;
+        r.positive = true;
+        r2 = fromLimbs(ctx.rSquared(), ctx.size());
+        return a.toMontgomery(ctx).montgomeryMul(b.toMontgomery(ctx), ctx).fromMontgomery(ctx);
+    }
+
+    // Non-owning view of this value, valid while it is alive and unchanged. The conversion
+    // lets a BigInt stand on either side of an operator whose other operand is a view.
+    BigIntView view() const {
+        return BigIntView(limbs.data(), limbs.size(), !positive);
+    }
 
-        r2 = powMod(two, degree, P);
+    operator BigIntView() const {
+        return view();
+    }
+
+    explicit BigInt(const BigIntView& value) : positive(!value.negative()) {
+        if (!value.isZero()) limbs.assign(value.data(), value.data() + value.size());
+    }
 
-        std::string str = getMod(P);
-        unsigned long long p = 0, a1 = -stoi(str), e1 = -1, m = 4294967296;
-        p = powMod(a1, e1, m);
-        Pinv = std::to_string(p);
+    size_t serializedSize() const {
+        return mpn::serializedSize(limbs.size());
+    }
+
+    // Writes the binary form (see Serialization.cpp) into [first, last) and returns the end of
+    // the written bytes; throws if it does not fit.
+    unsigned char* serialize(unsigned char* first, unsigned char* last) const {
+        if (size_t(last - first) < serializedSize()) {
+            throw std::runtime_error("Buffer too small");
+        }
+        return mpn::serialize(first, limbs.data(), limbs.size(), !positive);
+    }
 
-        BigInt a_prim = m_transform(a, r2, Pinv, r, P); // mult a by 2 ^ 32
-        BigInt b_prim = m_transform(b, r2, Pinv, r, P); // mult b by 2 ^ 32
-        BigInt prod_prim = m_reduce(a_prim * b_prim, Pinv, r, P); // divide a' * b' by 2 ^ 32
-        BigInt prod = m_reduce(prod_prim, Pinv, r, P); // divide prod' by 2^32
-        prod.print();
-        return prod;
+    std::vector<unsigned char> serialize() const {
+        std::vector<unsigned char> bytes(serializedSize());
+        serialize(bytes.data(), bytes.data() + bytes.size());
+        return bytes;
+    }
+
+    // Reads a value written by serialize; trailing bytes after the limbs are ignored.
+    static BigInt deserialize(const unsigned char* first, const unsigned char* last) {
+        bool negative;
+        size_t n = mpn::readSerializedHeader(first, last, negative);
+        const unsigned char* in = first + mpn::SERIAL_HEADER_BYTES;
+        BigInt result;
+        result.limbs.resize(n);
+        if (mpn::littleEndianHost()) {
+            if (n != 0) std::memcpy(result.limbs.data(), in, n * sizeof(Limb));
+        }
+        else {
+            for (size_t i = 0; i < n; ++i) result.limbs[i] = mpn::loadLimb(in + i * sizeof(Limb));
+        }
+        result.positive = !negative;
+        result.removeLeadingZeros();
+        return result;
+    }
+
+    friend BigInt operator+(const BigIntView& a, const BigIntView& b);
+    friend BigInt operator-(const BigIntView& a, const BigIntView& b);
+    friend BigInt operator*(const BigIntView& a, const BigIntView& b);
+    friend std::pair<BigInt, BigInt> operator/(const BigIntView& a, const BigIntView& b);
+
+    const LimbVector& magnitude() const {
+        return limbs;
+    }
+
+    // *this mod N (taken non-negative), times R
+    BigInt toMontgomery(const MontgomeryContext& ctx) const {
+        LimbBuffer a = residue(ctx);
+        LimbBuffer scratch(ctx.scratchSize());
+        ctx.toMontgomery(a.data(), a.data(), scratch.data());
+        return fromLimbs(a.data(), a.size());
+    }
+
+    BigInt fromMontgomery(const MontgomeryContext& ctx) const {
+        LimbBuffer a = residue(ctx);
+        LimbBuffer scratch(ctx.scratchSize());
+        ctx.fromMontgomery(a.data(), a.data(), scratch.data());
+        return fromLimbs(a.data(), a.size());
+    }
+
+    // Product of two Montgomery-form residues, still in Montgomery form.
+    BigInt montgomeryMul(const BigInt& other, const MontgomeryContext& ctx) const {
+        LimbBuffer a = residue(ctx);
+        LimbBuffer b = other.residue(ctx);
+        LimbBuffer scratch(ctx.scratchSize());
+        ctx.mul(a.data(), a.data(), b.data(), scratch.data());
+        return fromLimbs(a.data(), a.size());
     }
 private:
-    std::string getMod(const BigInt& mod) {
-        std::string str;
-        for (size_t i = 0; i < mod.digits.size(); ++i) {
-            str += std::to_string(mod.digits[i]);
+    static BigInt fromLimbs(const Limb* a, size_t n) {
+        BigInt result;
+        result.limbs.assign(a, a + n);
+        result.removeLeadingZeros();
+        return result;
+    }
+
+    // floor(n^(1/k)) and n - root^k for n >= 0. The root of n >> (k * shift), shifted back,
+    // has a little over half the bits of the answer, and one Newton step
+    //     x = ((k - 1) * x + n / x^(k-1)) / k
+    // brings it within a unit; each level of the recursion doubles the precision, so the
+    // whole costs a few divisions at full size.
+    static std::pair<BigInt, BigInt> rootMagnitude(const BigInt& n, unsigned k) {
+        size_t bits = n.bitLength();
+        if (k == 1 || bits == 0) {
+            return std::make_pair(n, zero());
         }
-        reverse(str.begin(), str.end());
-        return str;
+        size_t rootBits = (bits + k - 1) / k;
+        BigInt degree((long long)k);
+        BigInt x;
+        if (rootBits <= 32) {
+            x = BigInt((long long)rootEstimate(n, k));
+        }
+        else {
+            size_t guard = mpn::bitLength(&degree.limbs[0], 1) + 1;
+            size_t shift = rootBits / 2 > guard + 1 ? rootBits / 2 - guard : 1;
+            x = rootMagnitude(n >> int(shift * k), k).first << int(shift);
+            BigInt power = x.binaryPower(BigInt((long long)k - 1));
+            x = ((x * BigInt((long long)k - 1) + (n / power).first) / degree).first;
+        }
+        BigInt power = x.binaryPower(degree);
+        while (power > n) {
+            x -= one();
+            power = x.binaryPower(degree);
+        }
+        for (BigInt next = (x + one()).binaryPower(degree); next <= n; next = (x + one()).binaryPower(degree)) {
+            x += one();
+            power = std::move(next);
+        }
+        return std::make_pair(x, n - power);
     }
 
-    unsigned long long powMod(unsigned long long a, unsigned long long e, unsigned long long m) {
-        unsigned long long r = 1;
-        while (e > 0) {
-            if (e & 1)
-                r = (r * a) % m;
-            e >>= 1;
-            a = (unsigned long long)(a * a) % m;
+    // n^(1/k) rounded, from the top 64 bits of n, for roots below 2^32
+    static Limb rootEstimate(const BigInt& n, unsigned k) {
+        size_t bits = n.bitLength();
+        size_t drop = bits > 64 ? bits - 64 : 0;
+        BigInt top = n >> int(drop);
+        return Limb(std::exp2((std::log2(double(top.limbs[0])) + double(drop)) / k) + 0.5);
+    }
+
+    // isProbablePrime past trial division, for odd values above the small primes. The base-2
+    // round comes first since it rejects nearly every composite on its own; squares are
+    // ruled out before the search for a Lucas parameter, which would not end for them.
+    bool isProbablePrimeOdd(unsigned rounds) const {
+        size_t n = limbs.size();
+        MontgomeryContext ctx(limbs);
+        LimbBuffer base(n, 0);
+        base[0] = 2;
+        if (!mpn::millerRabin(ctx, base.data())) return false;
+        if (isqrtRem().second.limbs.empty()) return false;
+        std::atomic<bool> composite(false);
+        mpn::TaskGroup tasks(mpn::parallelPool(n * n * (rounds + 1)));
+        tasks.run([&] {
+            if (!mpn::strongLucas(ctx)) composite = true;
+        });
+        Limb seed = mpn::mod1(limbs.data(), n, Limb(0) - 59);
+        for (unsigned i = 0; i < rounds; ++i) {
+            tasks.run([&, i] {
+                if (composite) return;
+                LimbBuffer witness(n);
+                mpn::randomWitness(witness.data(), limbs.data(), n, seed + i * 0x632be59bd9b4e019ull);
+                if (!mpn::millerRabin(ctx, witness.data())) composite = true;
+            });
         }
-        //std::cout << "A=" << a << ", E=" << e << ", R=" << r << std::endl;
-        return r;
+        tasks.wait();
+        return !composite;
     }
 
-    BigInt m_reduce(BigInt ab, BigInt Pinv, BigInt r, BigInt P) {
-        BigInt m = ab * Pinv % r;
-        return ((ab + m * P) / r).first;
+    // The least prime p >= from, odd when oddOnly, with this = root^p for this >= 2, or 0 when
+    // there is none. Each candidate is screened at a cost independent of the length before a
+    // root is taken: p has to divide the trailing zero count; when the root of the odd part o
+    // fits in a limb, it is the 2-adic root of o mod 2^64 and has to have the size of the real
+    // one; otherwise o has to be a p-th power modulo three primes q = 1 (mod p), the residues
+    // of all of them coming from one remainder tree. A 2-adic root that passes is checked by
+    // one exact power rather than a Newton root.
+    unsigned leastPowerPrime(unsigned from, bool oddOnly, BigInt& root) const {
+        size_t bits = bitLength();
+        size_t zeros = trailingZeroBits();
+        size_t oddBits = bits - zeros;
+        BigInt odd = *this >> int(zeros);
+        size_t drop = oddBits > 64 ? oddBits - 64 : 0;
+        double logOdd = std::log2(double((odd >> int(drop)).limbs[0])) + double(drop);
+        std::vector<bool> composite(bits + 1, false);
+        std::vector<std::pair<unsigned, Limb>> candidates;  // p and the root of o, 0 when unknown
+        std::vector<unsigned> residueTested;
+        LimbBuffer moduli;
+        for (unsigned p = 2; p <= bits; ++p) {
+            if (composite[p]) continue;
+            for (size_t q = size_t(p) * p; q < composite.size(); q += p) composite[q] = true;
+            if (p < from || (oddOnly && p == 2) || zeros % p != 0) continue;
+            if (oddBits <= size_t(mpn::LIMB_BITS) * p && p != 2) {
+                Limb r = mpn::twoAdicRoot(odd.limbs[0], p);
+                if (std::fabs(std::log2(double(r)) - logOdd / p) > 1e-9) continue;
+                candidates.push_back(std::make_pair(p, r));
+                continue;
+            }
+            residueTested.push_back(p);
+            int found = 0;
+            for (Limb q = 2 * Limb(p) + 1; found < 3 && q < (Limb(1) << 32); q += 2 * Limb(p)) {
+                if (!mpn::isPrimeWord(q)) continue;
+                moduli.push_back(q);
+                ++found;
+            }
+            while (found++ < 3) moduli.push_back(1);
+        }
+        LimbBuffer residues = residuesModulo(odd, moduli);
+        for (size_t i = 0; i < residueTested.size(); ++i) {
+            unsigned p = residueTested[i];
+            bool power = true;
+            for (size_t j = 3 * i; j < 3 * i + 3 && power; ++j) {
+                Limb q = moduli[j];
+                if (q == 1 || residues[j] == 0) continue;
+                power = mpn::powModWord(residues[j], (q - 1) / p, q) == 1;
+            }
+            if (power) candidates.push_back(std::make_pair(p, Limb(0)));
+        }
+        std::sort(candidates.begin(), candidates.end());
+        for (const std::pair<unsigned, Limb>& c : candidates) {
+            unsigned p = c.first;
+            if (c.second != 0) {
+                root = fromLimbs(&c.second, 1);
+                if (root.power(p) == odd) {
+                    root <<= int(zeros / p);
+                    return p;
+                }
+                continue;
+            }
+            std::pair<BigInt, BigInt> r = rootMagnitude(*this, p);
+            if (r.second.limbs.empty()) {
+                root = std::move(r.first);
+                return p;
+            }
+        }
+        return 0;
     }
 
-    BigInt m_transform(BigInt a, BigInt r2, BigInt Pinv, BigInt r, BigInt P) {
-        return m_reduce((a * r2), Pinv, r, P);
+    // n mod each of the moduli, all below 2^32: a product tree over pairs of them, then
+    // remainders taken down it, so n itself is divided once rather than once per modulus.
+    static LimbBuffer residuesModulo(const BigInt& n, const LimbBuffer& moduli) {
+        LimbBuffer residues(moduli.size());
+        if (moduli.empty()) return residues;
+        std::vector<std::vector<BigInt>> tree(1);
+        for (size_t i = 0; i < moduli.size(); i += 2) {
+            Limb product = moduli[i] * (i + 1 < moduli.size() ? moduli[i + 1] : 1);
+            tree[0].push_back(fromLimbs(&product, 1));
+        }
+        while (tree.back().size() > 1) {
+            std::vector<BigInt> up;
+            const std::vector<BigInt>& level = tree.back();
+            for (size_t i = 0; i < level.size(); i += 2) {
+                up.push_back(i + 1 < level.size() ? level[i] * level[i + 1] : level[i]);
+            }
+            tree.push_back(std::move(up));
+        }
+        std::vector<BigInt> rem(1, n % tree.back()[0]);
+        for (size_t k = tree.size() - 1; k-- > 0;) {
+            std::vector<BigInt> down;
+            for (size_t i = 0; i < tree[k].size(); ++i) down.push_back(rem[i / 2] % tree[k][i]);
+            rem = std::move(down);
+        }
+        for (size_t i = 0; i < moduli.size(); ++i) {
+            const BigInt& r = rem[i / 2];
+            residues[i] = r.limbs.empty() ? 0 : r.limbs[0] % moduli[i];
+        }
+        return residues;
+    }
+
+    // Bumped by clearPowerCache; quaryPower drops a cache filled under another generation.
+    static unsigned& powerCacheGeneration() {
+        static thread_local unsigned generation = 0;
+        return generation;
     }
-    std::pair<BigInt, std::pair<BigInt, BigInt>> extGCD(const BigInt& a, const BigInt& b, BigInt& x, BigInt& y) {
-        if (a == BigInt("0")) {
-            x = BigInt("0");
-            y = BigInt("1");
-            return std::make_pair(b, std::make_pair(x, y));
+
+    // this^e for an odd positive this, left to right over k-bit windows of e with a table of
+    // the odd powers up to this^(2^k - 1). A one-limb base keeps k = 1, since multiplying by
+    // it is a single pass; for a longer one k minimises the windows plus the table entries.
+    BigInt windowPower(Limb e) const {
+        if (e == 0) return one();
+        if (limbs.size() == 1 && limbs[0] == 1) return one();
+        unsigned bits = unsigned(mpn::LIMB_BITS - mpn::countLeadingZeros(e));
+        unsigned k = 1;
+        if (limbs.size() > 1) {
+            size_t best = windowCount(e, 1);
+            for (unsigned w = 2; w <= 5; ++w) {
+                size_t cost = windowCount(e, w) + (size_t(1) << (w - 1)) - 1;
+                if (cost < best) {
+                    best = cost;
+                    k = w;
+                }
+            }
         }
-        BigInt x1;
-        BigInt y1;
-        BigInt d = extGCD((b / a).second, a, x1, y1).first;
-        x = y1 - (b / a).first * x1;
-        y = x1;
-        return std::make_pair(d, std::make_pair(x, y));
+        std::vector<BigInt> table(size_t(1) << (k - 1));
+        table[0] = *this;
+        if (k > 1) {
+            BigInt square = *this * *this;
+            for (size_t i = 1; i < table.size(); ++i) table[i] = table[i - 1] * square;
+        }
+        BigInt result;
+        bool first = true;
+        for (unsigned i = bits; i-- > 0;) {
+            if (!((e >> i) & 1)) {
+                result *= result;
+                continue;
+            }
+            unsigned low = i + 1 >= k ? i + 1 - k : 0;
+            while (!((e >> low) & 1)) ++low;
+            unsigned width = i - low + 1;
+            const BigInt& power = table[((e >> low) & ((Limb(1) << width) - 1)) >> 1];
+            if (first) {
+                result = power;
+                first = false;
+            }
+            else {
+                for (unsigned j = 0; j < width; ++j) result *= result;
+                result *= power;
+            }
+            i = low;
+        }
+        return result;
     }
-    std::pair<BigInt, BigInt> divideWithRemainder(const BigInt& divisor) const {
-        if (divisor == BigInt("0")) {
-            throw std::runtime_error("Division by zero");
+
+    // Sliding k-bit windows in e
+    static size_t windowCount(Limb e, unsigned k) {
+        size_t count = 0;
+        while (e != 0) {
+            if (e & 1) {
+                ++count;
+                e = k >= 64 ? 0 : e >> k;
+            }
+            else {
+                e >>= 1;
+            }
+        }
+        return count;
+    }
+
+    // Digits of x >= 0 in base q, least significant first
+    static std::vector<int> radixDigits(int x, int q) {
+        std::vector<int> digits;
+        for (; x > 0; x /= q) digits.push_back(x % q);
+        return digits;
+    }
+
+    size_t trailingZeroBits() const {
+        size_t i = 0;
+        while (i < limbs.size() && limbs[i] == 0) ++i;
+        return i == limbs.size() ? 0 : i * mpn::LIMB_BITS + mpn::countTrailingZeros(limbs[i]);
+    }
+
+    static void checkExponent(const BigInt& e) {
+        if (!e.positive) {
+            throw std::runtime_error("Negative exponent not supported");
         }
+    }
 
-        BigInt quotient("0");
-        BigInt remainder(*this);
+    // Modulus limbs times exponent limbs summed over a batch, the size parallelPool weighs
+    static size_t batchWork(const BigInt* exponents, const BigInt* moduli, size_t count) {
+        size_t work = 0;
+        for (size_t i = 0; i < count; ++i) {
+            work += moduli[i].limbs.size() * std::max<size_t>(exponents[i].limbs.size(), 1);
+        }
+        return work;
+    }
+
+    // Queues the exponentiations of one modulus in chunks. Short moduli go POW_LANES at a
+    // time through the interleaved kernel; a short last chunk pads its lanes with exponent 0.
+    static void powModGroup(const BigInt* bases, const BigInt* exponents, const size_t* group, size_t count,
+        const MontgomeryContext& ctx, BigInt* results, mpn::TaskGroup& tasks) {
+        const size_t L = mpn::POW_LANES;
+        if (ctx.size() > BIGINT_BATCH_LANE_LIMBS) {
+            for (size_t i = 0; i < count; ++i) {
+                size_t k = group[i];
+                tasks.run([=, &ctx] { results[k] = bases[k].powMod(exponents[k], ctx); });
+            }
+            return;
+        }
+        size_t chunk = L * std::max<size_t>(1, count / (L * 4 * mpn::parallelThreads()));
+        for (size_t begin = 0; begin < count; begin += chunk) {
+            size_t end = std::min(count, begin + chunk);
+            tasks.run([=, &ctx] {
+                for (size_t i = begin; i < end; i += L) {
+                    powModLanes(bases, exponents, group + i, std::min(L, end - i), ctx, results);
+                }
+            });
+        }
+    }
 
-        while (remainder >= divisor) { 
-            BigInt temp = divisor;
-            BigInt multiple("1");
-            while (temp <= remainder) {
-                temp = temp + divisor;
-                multiple = multiple + BigInt("1");
+    // Up to POW_LANES exponentiations with one context through the lane-interleaved kernel
+    static void powModLanes(const BigInt* bases, const BigInt* exponents, const size_t* lanes, size_t used,
+        const MontgomeryContext& ctx, BigInt* results) {
+        const size_t L = mpn::POW_LANES;
+        size_t n = ctx.size();
+        LimbBuffer b(n * L, 0), r(n * L), factor(n * L, 0), scratch((n + 2) * L);
+        const Limb* e[L];
+        size_t en[L];
+        for (size_t l = 0; l < L; ++l) {
+            e[l] = nullptr;
+            en[l] = 0;
+            if (l >= used) continue;
+            const BigInt& exponent = exponents[lanes[l]];
+            e[l] = exponent.limbs.data();
+            en[l] = exponent.limbs.size();
+            LimbBuffer a = bases[lanes[l]].residue(ctx);
+            for (size_t j = 0; j < n; ++j) {
+                b[j * L + l] = a[j];
+                factor[j * L + l] = ctx.rSquared()[j];
             }
-            remainder = remainder - (temp - divisor);
-            quotient = quotient + (multiple - BigInt("1"));
         }
+        mpn::montgomeryMulLanes(b.data(), b.data(), factor.data(), ctx, scratch.data());
+        mpn::powModLanes(r.data(), b.data(), e, en, ctx);
+        std::fill(factor.begin(), factor.end(), 0);
+        std::fill(factor.begin(), factor.begin() + L, 1);
+        mpn::montgomeryMulLanes(r.data(), r.data(), factor.data(), ctx, scratch.data());
+        for (size_t l = 0; l < used; ++l) {
+            BigInt& result = results[lanes[l]];
+            result.limbs.assign(n, 0);
+            for (size_t j = 0; j < n; ++j) result.limbs[j] = r[j * L + l];
+            result.positive = true;
+            result.removeLeadingZeros();
+        }
+    }
 
-        quotient.positive = positive == divisor.positive;
-        remainder.positive = positive;
+    template <class Context>
+    static BigInt multiPowMod(const BigInt* bases, const BigInt* exponents, size_t count, const Context& ctx) {
+        BIGINT_PROBE(PowMod, ctx.size() * std::max<size_t>(count, 1));
+        size_t n = ctx.size();
+        LimbBuffer residues(count * n);
+        LimbBuffer scratch(ctx.scratchSize());
+        std::vector<const Limb*> b(count), e(count);
+        std::vector<size_t> en(count);
+        for (size_t i = 0; i < count; ++i) {
+            LimbBuffer x = bases[i].residue(ctx);
+            toResidueForm(x.data(), ctx, scratch.data());
+            std::copy(x.begin(), x.end(), residues.begin() + i * n);
+            b[i] = &residues[i * n];
+            e[i] = exponents[i].limbs.data();
+            en[i] = exponents[i].limbs.size();
+        }
+        LimbBuffer r(n);
+        mpn::multiPow(r.data(), b.data(), e.data(), en.data(), count, ctx);
+        fromResidueForm(r.data(), ctx, scratch.data());
+        return fromLimbs(r.data(), r.size());
+    }
 
-        return std::make_pair(quotient, remainder);
+    // Between plain residues and the form a context computes in, in place
+    static void toResidueForm(Limb* a, const MontgomeryContext& ctx, Limb* scratch) {
+        ctx.toMontgomery(a, a, scratch);
     }
 
-    bool absoluteIsGreaterThanOrEqual(const BigInt& other) const {
-        return absoluteIsGreaterThan(other) || *this == other;
+    static void toResidueForm(Limb*, const BarrettContext&, Limb*) {
+    }
+
+    static void fromResidueForm(Limb* a, const MontgomeryContext& ctx, Limb* scratch) {
+        ctx.fromMontgomery(a, a, scratch);
     }
-    BigInt addAbsolute(const BigInt& other) const {
-        BigInt result;
-        result.digits.resize(std::max(digits.size(), other.digits.size()), 0);
 
-        int carry = 0;
-        for (size_t i = 0; i < result.digits.size(); ++i) {
-            int sum = carry;
-            if (i < digits.size()) sum += digits[i];
-            if (i < other.digits.size()) sum += other.digits[i];
+    static void fromResidueForm(Limb*, const BarrettContext&, Limb*) {
+    }
+
+    LimbBuffer residue(const MontgomeryContext& ctx) const {
+        return residue(ctx.modulus(), ctx.size());
+    }
 
-            result.digits[i] = sum % 10;
-            carry = sum / 10;
+    LimbBuffer residue(const BarrettContext& ctx) const {
+        LimbBuffer r(ctx.size());
+        ctx.reduce(r.data(), limbs.data(), limbs.size());
+        if (!positive && mpn::normalizedSize(r.data(), r.size()) > 0) {
+            mpn::sub(r.data(), ctx.modulus(), ctx.size(), r.data(), ctx.size());
         }
+        return r;
+    }
 
-        if (carry > 0) {
-            result.digits.push_back(carry);
+    // *this reduced into [0, N), padded to the n limbs of N
+    LimbBuffer residue(const Limb* mod, size_t n) const {
+        LimbBuffer r(limbs.begin(), limbs.end());
+        if (limbs.size() >= n) {
+            BigInt modulus = fromLimbs(mod, n);
+            BigInt magnitude = fromLimbs(limbs.data(), limbs.size());
+            BigInt rem = magnitude.divideWithRemainder(modulus).second;
+            r.assign(rem.limbs.begin(), rem.limbs.end());
         }
+        r.resize(n, 0);
+        if (!positive && mpn::normalizedSize(r.data(), n) > 0) {
+            mpn::sub(r.data(), mod, n, r.data(), n);
+        }
+        return r;
+    }
 
-        return result;
+    // gcd(|a|, |b|), with x getting the cofactor of a: a*x = d (mod b)
+    static BigInt gcdCofactor(const BigInt& a, const BigInt& b, BigInt& x) {
+        BigInt d;
+        d.limbs.resize(std::max(a.limbs.size(), b.limbs.size()));
+        x.limbs.resize(a.limbs.size() + b.limbs.size() + 2);
+        size_t xn;
+        bool xNegative;
+        d.limbs.resize(mpn::gcdExt(d.limbs.data(), x.limbs.data(), xn, xNegative,
+            a.limbs.data(), a.limbs.size(), b.limbs.data(), b.limbs.size()));
+        x.limbs.resize(xn);
+        x.positive = !xNegative;
+        return d;
     }
 
-    BigInt subtractAbsolute(const BigInt& other) const {
-        BigInt result;
-        result.digits.resize(std::max(digits.size(), other.digits.size()), 0);
-
-        int borrow = 0;
-        for (size_t i = 0; i < result.digits.size(); ++i) {
-            int diff = borrow;
-            if (i < digits.size()) diff += digits[i];
-            if (i < other.digits.size()) diff -= other.digits[i];
-            if (diff < 0) {
-                diff += 10; 
-                borrow = -1;
+    // The same recurrence as the Lehmer path, one operator/ per step, iterative so long
+    // remainder sequences cannot exhaust the stack.
+    static std::pair<BigInt, std::pair<BigInt, BigInt>> extendedGCDSigned(BigInt a, BigInt b) {
+        BigInt x0 = one(), y0 = zero();
+        BigInt x1 = zero(), y1 = one();
+        while (a != zero()) {
+            std::pair<BigInt, BigInt> qr = b / a;
+            b = std::move(a);
+            a = std::move(qr.second);
+            x1 -= qr.first * x0;
+            y1 -= qr.first * y0;
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+        return std::make_pair(b, std::make_pair(x1, y1));
+    }
+
+    // Magnitudes only; callers fix up the signs. Quotient and remainder come out of one pass.
+    std::pair<BigInt, BigInt> divideWithRemainder(const BigInt& divisor) const {
+        BIGINT_PROBE(Divide, limbs.size() + divisor.limbs.size());
+        if (divisor.limbs.empty()) {
+            throw std::runtime_error("Division by zero");
+        }
+
+        BigInt quotient;
+        BigInt remainder;
+
+        if (absoluteIsGreaterThanOrEqual(divisor)) {
+            quotient.limbs.resize(limbs.size() - divisor.limbs.size() + 1);
+            remainder.limbs.resize(divisor.limbs.size());
+            mpn::divRem(quotient.limbs.data(), remainder.limbs.data(),
+                limbs.data(), limbs.size(), divisor.limbs.data(), divisor.limbs.size());
+        }
+        else {
+            remainder.limbs = limbs;
+        }
+
+        quotient.removeLeadingZeros();
+        remainder.removeLeadingZeros();
+        return std::make_pair(quotient, remainder);
+    }
+
+    // *this += |b| when bPositive, -= |b| otherwise; b must not alias limbs
+    void addSigned(const Limb* b, size_t bn, bool bPositive) {
+        size_t an = limbs.size();
+        if (bn == 0) {
+            return;
+        }
+        if (an == 0) {
+            limbs.assign(b, b + bn);
+            positive = bPositive;
+            return;
+        }
+        if (positive == bPositive) {
+            size_t n = std::max(an, bn);
+            limbs.resize(n + 1);
+            limbs[n] = mpn::add(limbs.data(), limbs.data(), n, b, bn);
+        }
+        else {
+            int c = an != bn ? (an > bn ? 1 : -1) : mpn::cmp(limbs.data(), b, an);
+            if (c >= 0) {
+                mpn::sub(limbs.data(), limbs.data(), an, b, bn);
             }
             else {
-                borrow = 0;
+                limbs.resize(bn);
+                mpn::sub(limbs.data(), b, bn, limbs.data(), an);
+                positive = bPositive;
             }
-
-            result.digits[i] = diff;
         }
+        removeLeadingZeros();
+    }
 
+    bool absoluteIsGreaterThanOrEqual(const BigInt& other) const {
+        return !other.absoluteIsGreaterThan(*this);
+    }
+    BigInt addAbsolute(const BigInt& other) const {
+        const BigInt& longer = limbs.size() >= other.limbs.size() ? *this : other;
+        const BigInt& shorter = limbs.size() >= other.limbs.size() ? other : *this;
+        BigInt result;
+        result.limbs.resize(longer.limbs.size() + 1);
+        result.limbs.back() = mpn::add(result.limbs.data(), longer.limbs.data(), longer.limbs.size(), shorter.limbs.data(), shorter.limbs.size());
+        result.removeLeadingZeros();
+        return result;
+    }
+
+    // requires |*this| >= |other|
+    BigInt subtractAbsolute(const BigInt& other) const {
+        BigInt result;
+        result.limbs.resize(limbs.size());
+        mpn::sub(result.limbs.data(), limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
         result.removeLeadingZeros();
         return result;
     }
 
     bool absoluteIsGreaterThan(const BigInt& other) const {
-        if (digits.size() > other.digits.size()) return true;
-        if (digits.size() < other.digits.size()) return false;
-        for (int i = digits.size() - 1; i >= 0; --i) {
-            if (digits[i] > other.digits[i]) return true;
-            if (digits[i] < other.digits[i]) return false;
-        }
-        return false;
+        if (limbs.size() > other.limbs.size()) return true;
+        if (limbs.size() < other.limbs.size()) return false;
+        return mpn::cmp(limbs.data(), other.limbs.data(), limbs.size()) > 0;
+    }
+
+    template <class Op>
+    BigInt bitwise(const BigInt& other, Op op) const {
+        BIGINT_PROBE(Bitwise, limbs.size() + other.limbs.size());
+        BigInt result;
+        result.limbs.resize(std::max(limbs.size(), other.limbs.size()) + 1);
+        result.positive = !mpn::bitwise(result.limbs.data(), limbs.data(), limbs.size(), !positive,
+            other.limbs.data(), other.limbs.size(), !other.positive, op);
+        result.removeLeadingZeros();
+        return result;
     }
 
     void removeLeadingZeros() {
-        while (digits.size() > 1 && digits.back() == 0) {
-            digits.pop_back();
+        while (!limbs.empty() && limbs.back() == 0) {
+            limbs.pop_back();
         }
+        if (limbs.empty()) {
+            positive = true;
+        }
+    }
+
+    void parseDecimal(const char* str, size_t len) {
+        BIGINT_PROBE(Parse, len / mpn::DECIMAL_CHUNK_DIGITS + 1);
+        mpn::parseDecimal(limbs, str, len);
+        removeLeadingZeros();
+    }
+
+    // Decimal digits are given least significant first.
+    void assignDecimalDigits(std::vector<int>::const_iterator begin, std::vector<int>::const_iterator end) {
+        std::string str;
+        for (auto it = end; it != begin;) {
+            --it;
+            str.push_back(char('0' + *it));
+        }
+        parseDecimal(str.data(), str.size());
     }
 };
+
+// Arithmetic on views reads the operands in place, with the same signs as the BigInt operators.
+// Expressions with no view operand keep using the members.
+inline BigInt operator+(const BigIntView& a, const BigIntView& b) {
+    BigInt result(a);
+    result.addSigned(b.data(), b.size(), !b.negative());
+    return result;
+}
+
+inline BigInt operator-(const BigIntView& a, const BigIntView& b) {
+    BigInt result(a);
+    result.addSigned(b.data(), b.size(), b.negative());
+    return result;
+}
+
+inline BigInt operator*(const BigIntView& a, const BigIntView& b) {
+    BigInt result;
+    if (a.isZero() || b.isZero()) {
+        return result;
+    }
+    result.limbs.resize(a.size() + b.size(), 0);
+    mpn::mul(result.limbs.data(), a.data(), a.size(), b.data(), b.size());
+    result.positive = a.negative() == b.negative();
+    result.removeLeadingZeros();
+    return result;
+}
+
+inline std::pair<BigInt, BigInt> operator/(const BigIntView& a, const BigIntView& b) {
+    if (b.isZero()) {
+        throw std::runtime_error("Division by zero");
+    }
+    BigInt quotient;
+    BigInt remainder;
+    if (a.size() >= b.size()) {
+        quotient.limbs.resize(a.size() - b.size() + 1);
+        remainder.limbs.resize(b.size());
+        mpn::divRem(quotient.limbs.data(), remainder.limbs.data(), a.data(), a.size(), b.data(), b.size());
+    }
+    else {
+        remainder = BigInt(a);
+    }
+    quotient.positive = a.negative() == b.negative();
+    remainder.positive = quotient.positive;
+    quotient.removeLeadingZeros();
+    remainder.removeLeadingZeros();
+    return std::make_pair(quotient, remainder);
+}
+
+inline BigInt operator%(const BigIntView& a, const BigIntView& b) {
+    return (a / b).second;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include "Limbs.cpp"
+
+namespace mpn {
+
+    inline int popCount(Limb x) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return int((x * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    inline size_t popCount(const Limb* a, size_t n) {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i) count += popCount(a[i]);
+        return count;
+    }
+
+    inline bool testBit(const Limb* a, size_t bit) {
+        return (a[bit / LIMB_BITS] >> (bit % LIMB_BITS)) & 1;
+    }
+
+    // k bits of a starting at bit `low`, reading past the end as zeros
+    inline unsigned extractBits(const Limb* a, size_t n, size_t low, unsigned k) {
+        size_t word = low / LIMB_BITS;
+        unsigned shift = low % LIMB_BITS;
+        Limb bits = word < n ? a[word] >> shift : 0;
+        if (shift + k > LIMB_BITS && word + 1 < n) bits |= a[word + 1] << (LIMB_BITS - shift);
+        return unsigned(bits & ((Limb(1) << k) - 1));
+    }
+
+    inline size_t bitLength(const Limb* a, size_t n) {
+        n = normalizedSize(a, n);
+        return n == 0 ? 0 : n * LIMB_BITS - countLeadingZeros(a[n - 1]);
+    }
+
+    // Reads a sign-magnitude value as an infinite two's-complement word stream,
+    // negating on the fly so no copy of the operand is made.
+    class TwosComplementReader {
+    public:
+        TwosComplementReader(const Limb* a, size_t n, bool negative)
+            : a(a), n(n), mask(negative ? ~Limb(0) : 0), carry(negative ? 1 : 0) {
+        }
+
+        Limb next(size_t i) {
+            Limb word = (i < n ? a[i] : 0) ^ mask;
+            word += carry;
+            carry = carry & (word == 0);
+            return word;
+        }
+
+        Limb extension() const { return mask; }
+
+    private:
+        const Limb* a;
+        size_t n;
+        Limb mask;
+        Limb carry;
+    };
+
+    // r[0 .. n] = a op b on two's-complement operands, n = max(an, bn), converted back to a
+    // magnitude; returns true when the result is negative. r[n] holds the sign-extension
+    // limb before conversion, which is where -2^(64n) needs its top bit.
+    template <class Op>
+    bool bitwise(Limb* r, const Limb* a, size_t an, bool aNegative,
+        const Limb* b, size_t bn, bool bNegative, Op op) {
+        size_t n = std::max(an, bn);
+        TwosComplementReader x(a, an, aNegative);
+        TwosComplementReader y(b, bn, bNegative);
+        for (size_t i = 0; i < n; ++i) r[i] = op(x.next(i), y.next(i));
+        r[n] = op(x.extension(), y.extension());
+        bool negative = r[n] != 0;
+        if (negative) {
+            Limb carry = 1;
+            for (size_t i = 0; i <= n; ++i) {
+                r[i] = ~r[i] + carry;
+                carry = carry & (r[i] == 0);
+            }
+        }
+        return negative;
+    }
+
+    struct AndOp {
+        Limb operator()(Limb x, Limb y) const { return x & y; }
+    };
+
+    struct OrOp {
+        Limb operator()(Limb x, Limb y) const { return x | y; }
+    };
+
+    struct XorOp {
+        Limb operator()(Limb x, Limb y) const { return x ^ y; }
+    };
+}
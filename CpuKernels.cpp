@@ -0,0 +1,369 @@
+#pragma once
+#include "Limbs.cpp"
+
+// x86-64 versions of the hot limb kernels, picked once per process from CPUID:
+// - add/sub run four limbs per iteration on a single adc/sbb chain,
+// - mul1 uses BMI2 mulx so the multiplier never touches the flags,
+// - addMul1/subMul1 use ADX to keep the product and accumulate carries on two
+//   independent chains (adcx on CF, adox on OF),
+// - shifts use AVX2, four limbs per instruction.
+// The carry chains are GCC/Clang inline assembly; other compilers get the AVX2 shifts only.
+// Define BIGINT_PORTABLE_KERNELS to always use the portable loops.
+#if !defined(BIGINT_PORTABLE_KERNELS) && (defined(__x86_64__) || defined(_M_X64))
+#define BIGINT_X86_KERNELS
+#include <immintrin.h>
+#if defined(__GNUC__)
+#include <cpuid.h>
+#define BIGINT_ASM_KERNELS
+#define BIGINT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define BIGINT_TARGET_AVX2
+#endif
+#endif
+
+namespace mpn {
+
+#ifdef BIGINT_X86_KERNELS
+    namespace x86 {
+
+        struct CpuFeatures {
+            bool bmi2;
+            bool adx;
+            bool avx2;
+        };
+
+        inline void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(__GNUC__)
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#else
+            int out[4];
+            __cpuidex(out, int(leaf), int(subleaf));
+            for (int i = 0; i < 4; ++i) regs[i] = unsigned(out[i]);
+#endif
+        }
+
+        // Register state the OS saves on context switch; AVX needs XMM and YMM (bits 1 and 2).
+        inline unsigned long long xgetbv0() {
+#if defined(__GNUC__)
+            unsigned lo, hi;
+            __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            return (unsigned long long)hi << 32 | lo;
+#else
+            return _xgetbv(0);
+#endif
+        }
+
+        inline CpuFeatures detectFeatures() {
+            CpuFeatures features = { false, false, false };
+            unsigned regs[4];
+            cpuid(0, 0, regs);
+            if (regs[0] < 7) return features;
+            cpuid(1, 0, regs);
+            bool osAvx = (regs[2] >> 27 & 1) && (regs[2] >> 28 & 1) && (xgetbv0() & 6) == 6;
+            cpuid(7, 0, regs);
+            features.bmi2 = regs[1] >> 8 & 1;
+            features.adx = regs[1] >> 19 & 1;
+            features.avx2 = osAvx && (regs[1] >> 5 & 1);
+            return features;
+        }
+
+#ifdef BIGINT_ASM_KERNELS
+        // The loops below count blocks of four limbs down in rcx with lea and jrcxz, which leave
+        // CF and OF alone; the n % 4 low limbs go through the portable loop first.
+
+        inline Limb addN(Limb* r, const Limb* a, const Limb* b, size_t n) {
+            size_t head = n % 4;
+            size_t blocks = n / 4;
+            Limb carry = generic::addN(r, a, b, head);
+            if (blocks == 0) return carry;
+            r += head;
+            a += head;
+            b += head;
+            Limb t0, t1;
+            __asm__ volatile(
+                "add $-1, %[c]\n\t"
+                "1:\n\t"
+                "mov (%[a]), %[t0]\n\t"
+                "mov 8(%[a]), %[t1]\n\t"
+                "adc (%[b]), %[t0]\n\t"
+                "adc 8(%[b]), %[t1]\n\t"
+                "mov %[t0], (%[r])\n\t"
+                "mov %[t1], 8(%[r])\n\t"
+                "mov 16(%[a]), %[t0]\n\t"
+                "mov 24(%[a]), %[t1]\n\t"
+                "adc 16(%[b]), %[t0]\n\t"
+                "adc 24(%[b]), %[t1]\n\t"
+                "mov %[t0], 16(%[r])\n\t"
+                "mov %[t1], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[b]), %[b]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%%rcx), %%rcx\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n\t"
+                "2:\n\t"
+                "mov $0, %[c]\n\t"
+                "adc $0, %[c]\n\t"
+                : [c] "+r"(carry), [r] "+r"(r), [a] "+r"(a), [b] "+r"(b), "+c"(blocks),
+                  [t0] "=&r"(t0), [t1] "=&r"(t1)
+                :
+                : "cc", "memory");
+            return carry;
+        }
+
+        inline Limb subN(Limb* r, const Limb* a, const Limb* b, size_t n) {
+            size_t head = n % 4;
+            size_t blocks = n / 4;
+            Limb borrow = generic::subN(r, a, b, head);
+            if (blocks == 0) return borrow;
+            r += head;
+            a += head;
+            b += head;
+            Limb t0, t1;
+            __asm__ volatile(
+                "add $-1, %[c]\n\t"
+                "1:\n\t"
+                "mov (%[a]), %[t0]\n\t"
+                "mov 8(%[a]), %[t1]\n\t"
+                "sbb (%[b]), %[t0]\n\t"
+                "sbb 8(%[b]), %[t1]\n\t"
+                "mov %[t0], (%[r])\n\t"
+                "mov %[t1], 8(%[r])\n\t"
+                "mov 16(%[a]), %[t0]\n\t"
+                "mov 24(%[a]), %[t1]\n\t"
+                "sbb 16(%[b]), %[t0]\n\t"
+                "sbb 24(%[b]), %[t1]\n\t"
+                "mov %[t0], 16(%[r])\n\t"
+                "mov %[t1], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[b]), %[b]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%%rcx), %%rcx\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n\t"
+                "2:\n\t"
+                "mov $0, %[c]\n\t"
+                "adc $0, %[c]\n\t"
+                : [c] "+r"(borrow), [r] "+r"(r), [a] "+r"(a), [b] "+r"(b), "+c"(blocks),
+                  [t0] "=&r"(t0), [t1] "=&r"(t1)
+                :
+                : "cc", "memory");
+            return borrow;
+        }
+
+        // The high word of each product waits in c or t1, alternating, for the next limb.
+        inline Limb mul1(Limb* r, const Limb* a, size_t n, Limb b) {
+            size_t head = n % 4;
+            size_t blocks = n / 4;
+            Limb carry = generic::mul1(r, a, head, b);
+            if (blocks == 0) return carry;
+            r += head;
+            a += head;
+            Limb t0, t1;
+            __asm__ volatile(
+                "test %[c], %[c]\n\t"
+                "1:\n\t"
+                "mulx (%[a]), %[t0], %[t1]\n\t"
+                "adc %[c], %[t0]\n\t"
+                "mov %[t0], (%[r])\n\t"
+                "mulx 8(%[a]), %[t0], %[c]\n\t"
+                "adc %[t1], %[t0]\n\t"
+                "mov %[t0], 8(%[r])\n\t"
+                "mulx 16(%[a]), %[t0], %[t1]\n\t"
+                "adc %[c], %[t0]\n\t"
+                "mov %[t0], 16(%[r])\n\t"
+                "mulx 24(%[a]), %[t0], %[c]\n\t"
+                "adc %[t1], %[t0]\n\t"
+                "mov %[t0], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%%rcx), %%rcx\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n\t"
+                "2:\n\t"
+                "adc $0, %[c]\n\t"
+                : [c] "+r"(carry), [r] "+r"(r), [a] "+r"(a), "+c"(blocks),
+                  [t0] "=&r"(t0), [t1] "=&r"(t1)
+                : "d"(b)
+                : "cc", "memory");
+            return carry;
+        }
+
+        // lo + previous high on CF, then + r[i] on OF.
+        inline Limb addMul1(Limb* r, const Limb* a, size_t n, Limb b) {
+            size_t head = n % 4;
+            size_t blocks = n / 4;
+            Limb carry = generic::addMul1(r, a, head, b);
+            if (blocks == 0) return carry;
+            r += head;
+            a += head;
+            Limb t0, t1;
+            __asm__ volatile(
+                "xor %k[t0], %k[t0]\n\t"
+                "1:\n\t"
+                "mulx (%[a]), %[t0], %[t1]\n\t"
+                "adcx %[c], %[t0]\n\t"
+                "adox (%[r]), %[t0]\n\t"
+                "mov %[t0], (%[r])\n\t"
+                "mulx 8(%[a]), %[t0], %[c]\n\t"
+                "adcx %[t1], %[t0]\n\t"
+                "adox 8(%[r]), %[t0]\n\t"
+                "mov %[t0], 8(%[r])\n\t"
+                "mulx 16(%[a]), %[t0], %[t1]\n\t"
+                "adcx %[c], %[t0]\n\t"
+                "adox 16(%[r]), %[t0]\n\t"
+                "mov %[t0], 16(%[r])\n\t"
+                "mulx 24(%[a]), %[t0], %[c]\n\t"
+                "adcx %[t1], %[t0]\n\t"
+                "adox 24(%[r]), %[t0]\n\t"
+                "mov %[t0], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%%rcx), %%rcx\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n\t"
+                "2:\n\t"
+                "mov $0, %k[t0]\n\t"
+                "adcx %[t0], %[c]\n\t"
+                "adox %[t0], %[c]\n\t"
+                : [c] "+r"(carry), [r] "+r"(r), [a] "+r"(a), "+c"(blocks),
+                  [t0] "=&r"(t0), [t1] "=&r"(t1)
+                : "d"(b)
+                : "cc", "memory");
+            return carry;
+        }
+
+        // r - p is computed as r + ~p + 1: the product chain runs on CF, the complemented
+        // accumulate on OF, which starts at 1 and ends as the inverted borrow.
+        inline Limb subMul1(Limb* r, const Limb* a, size_t n, Limb b) {
+            size_t head = n % 4;
+            size_t blocks = n / 4;
+            Limb borrow = generic::subMul1(r, a, head, b);
+            if (blocks == 0) return borrow;
+            r += head;
+            a += head;
+            Limb t0, t1;
+            __asm__ volatile(
+                "mov $0x7fffffffffffffff, %[t0]\n\t"
+                "add $1, %[t0]\n\t"
+                "1:\n\t"
+                "mulx (%[a]), %[t0], %[t1]\n\t"
+                "adcx %[c], %[t0]\n\t"
+                "not %[t0]\n\t"
+                "adox (%[r]), %[t0]\n\t"
+                "mov %[t0], (%[r])\n\t"
+                "mulx 8(%[a]), %[t0], %[c]\n\t"
+                "adcx %[t1], %[t0]\n\t"
+                "not %[t0]\n\t"
+                "adox 8(%[r]), %[t0]\n\t"
+                "mov %[t0], 8(%[r])\n\t"
+                "mulx 16(%[a]), %[t0], %[t1]\n\t"
+                "adcx %[c], %[t0]\n\t"
+                "not %[t0]\n\t"
+                "adox 16(%[r]), %[t0]\n\t"
+                "mov %[t0], 16(%[r])\n\t"
+                "mulx 24(%[a]), %[t0], %[c]\n\t"
+                "adcx %[t1], %[t0]\n\t"
+                "not %[t0]\n\t"
+                "adox 24(%[r]), %[t0]\n\t"
+                "mov %[t0], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%%rcx), %%rcx\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n\t"
+                "2:\n\t"
+                "mov $0, %k[t0]\n\t"
+                "adcx %[t0], %[c]\n\t"
+                "seto %b[t0]\n\t"
+                : [c] "+r"(borrow), [r] "+r"(r), [a] "+r"(a), "+c"(blocks),
+                  [t0] "=&r"(t0), [t1] "=&r"(t1)
+                : "d"(b)
+                : "cc", "memory");
+            return borrow + 1 - t0;
+        }
+#endif
+
+        // Top down, so r >= a may overlap as in the portable loop.
+        BIGINT_TARGET_AVX2 inline Limb lshift(Limb* r, const Limb* a, size_t n, unsigned cnt) {
+            Limb out = a[n - 1] >> (64 - cnt);
+            __m128i left = _mm_cvtsi32_si128(int(cnt));
+            __m128i right = _mm_cvtsi32_si128(int(64 - cnt));
+            size_t i = n;
+            for (; i >= 5; i -= 4) {
+                __m256i high = _mm256_loadu_si256((const __m256i*)(a + i - 4));
+                __m256i low = _mm256_loadu_si256((const __m256i*)(a + i - 5));
+                _mm256_storeu_si256((__m256i*)(r + i - 4),
+                    _mm256_or_si256(_mm256_sll_epi64(high, left), _mm256_srl_epi64(low, right)));
+            }
+            for (; i > 1; --i) {
+                r[i - 1] = (a[i - 1] << cnt) | (a[i - 2] >> (64 - cnt));
+            }
+            r[0] = a[0] << cnt;
+            return out;
+        }
+
+        // Bottom up, so r <= a may overlap.
+        BIGINT_TARGET_AVX2 inline Limb rshift(Limb* r, const Limb* a, size_t n, unsigned cnt) {
+            Limb out = a[0] << (64 - cnt);
+            __m128i right = _mm_cvtsi32_si128(int(cnt));
+            __m128i left = _mm_cvtsi32_si128(int(64 - cnt));
+            size_t i = 0;
+            for (; i + 5 <= n; i += 4) {
+                __m256i low = _mm256_loadu_si256((const __m256i*)(a + i));
+                __m256i high = _mm256_loadu_si256((const __m256i*)(a + i + 1));
+                _mm256_storeu_si256((__m256i*)(r + i),
+                    _mm256_or_si256(_mm256_srl_epi64(low, right), _mm256_sll_epi64(high, left)));
+            }
+            for (; i + 1 < n; ++i) {
+                r[i] = (a[i] >> cnt) | (a[i + 1] << (64 - cnt));
+            }
+            r[n - 1] = a[n - 1] >> cnt;
+            return out;
+        }
+
+        inline KernelTable selectKernels() {
+            static const char* const names[2][4] = {
+                { "generic", "x86-64", "x86-64+bmi2", "x86-64+bmi2+adx" },
+                { "avx2", "x86-64+avx2", "x86-64+bmi2+avx2", "x86-64+bmi2+adx+avx2" }
+            };
+            KernelTable table = { generic::addN, generic::subN, generic::mul1, generic::addMul1,
+                generic::subMul1, generic::lshift, generic::rshift, names[0][0] };
+            CpuFeatures features = detectFeatures();
+            int level = 0;
+#ifdef BIGINT_ASM_KERNELS
+            table.addN = x86::addN;
+            table.subN = x86::subN;
+            level = 1;
+            if (features.bmi2) {
+                table.mul1 = x86::mul1;
+                level = 2;
+            }
+            if (features.bmi2 && features.adx) {
+                table.addMul1 = x86::addMul1;
+                table.subMul1 = x86::subMul1;
+                level = 3;
+            }
+#endif
+            if (features.avx2) {
+                table.lshift = x86::lshift;
+                table.rshift = x86::rshift;
+            }
+            table.name = names[features.avx2][level];
+            return table;
+        }
+    }
+#endif
+
+    // Chosen on first use and fixed for the life of the process.
+    inline const KernelTable& kernels() {
+#ifdef BIGINT_X86_KERNELS
+        static const KernelTable table = x86::selectKernels();
+#else
+        static const KernelTable table = { generic::addN, generic::subN, generic::mul1, generic::addMul1,
+            generic::subMul1, generic::lshift, generic::rshift, "generic" };
+#endif
+        return table;
+    }
+}
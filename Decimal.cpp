@@ -0,0 +1,175 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+#include "Division.cpp"
+
+// Below this many limbs (or 19 times as many digits) conversion runs chunk by chunk.
+#ifndef BIGINT_DECIMAL_DC_THRESHOLD
+#define BIGINT_DECIMAL_DC_THRESHOLD 24
+#endif
+
+namespace mpn {
+
+    const Limb DECIMAL_CHUNK = 10000000000000000000ULL; // 10^19
+    const size_t DECIMAL_CHUNK_DIGITS = 19;
+
+    // 10^(19 * 2^i), built once per process and shared by parsing and printing.
+    inline const LimbBuffer& decimalPower(size_t i) {
+        static std::deque<LimbBuffer> powers;
+        static std::mutex lock;
+        std::lock_guard<std::mutex> guard(lock);
+        if (powers.empty()) {
+            powers.push_back(LimbBuffer(1, DECIMAL_CHUNK));
+        }
+        while (powers.size() <= i) {
+            const LimbBuffer& last = powers.back();
+            LimbBuffer next(2 * last.size());
+            mul(next.data(), last.data(), last.size(), last.data(), last.size());
+            next.resize(normalizedSize(next.data(), next.size()));
+            powers.push_back(next);
+        }
+        return powers[i];
+    }
+
+    inline size_t decimalPowerDigits(size_t i) {
+        return DECIMAL_CHUNK_DIGITS << i;
+    }
+
+    inline Limb parseChunk(const char* str, size_t len) {
+        Limb chunk = 0;
+        for (size_t i = 0; i < len; ++i) {
+            unsigned digit = (unsigned char)str[i] - '0';
+            if (digit > 9) {
+                throw std::runtime_error("Invalid decimal digit");
+            }
+            chunk = chunk * 10 + digit;
+        }
+        return chunk;
+    }
+
+    // Quadratic base case: multiply-accumulate one 19-digit chunk at a time.
+    template <class Limbs>
+    void parseDecimalBasecase(Limbs& out, const char* str, size_t len) {
+        BIGINT_PROBE(ParseDecimalBasecase, len / DECIMAL_CHUNK_DIGITS + 1);
+        out.clear();
+        size_t first = len % DECIMAL_CHUNK_DIGITS;
+        if (first == 0) first = DECIMAL_CHUNK_DIGITS;
+        for (size_t pos = 0; pos < len; pos += first, first = DECIMAL_CHUNK_DIGITS) {
+            Limb chunk = parseChunk(str + pos, first);
+            Limb scale = 1;
+            for (size_t i = 0; i < first; ++i) scale *= 10;
+            Limb carry = out.empty() ? 0 : mul1(out.data(), out.data(), out.size(), scale);
+            if (carry) out.push_back(carry);
+            for (size_t i = 0; chunk != 0; ++i) {
+                if (i == out.size()) out.push_back(0);
+                out[i] += chunk;
+                chunk = out[i] < chunk;
+            }
+        }
+        out.resize(normalizedSize(out.data(), out.size()));
+    }
+
+    // value = high * 10^k + low, split at the largest cached power below the length.
+    template <class Limbs>
+    void parseDecimal(Limbs& out, const char* str, size_t len) {
+        if (len <= BIGINT_DECIMAL_DC_THRESHOLD * DECIMAL_CHUNK_DIGITS) {
+            parseDecimalBasecase(out, str, len);
+            return;
+        }
+        size_t i = 0;
+        while (decimalPowerDigits(i + 1) < len) ++i;
+        size_t lowDigits = decimalPowerDigits(i);
+        LimbBuffer high, low;
+        parseDecimal(high, str, len - lowDigits);
+        parseDecimal(low, str + len - lowDigits, lowDigits);
+        const LimbBuffer& power = decimalPower(i);
+        out.assign(high.size() + power.size() + 1, 0);
+        if (!high.empty()) {
+            mul(out.data(), high.data(), high.size(), power.data(), power.size());
+        }
+        if (!low.empty()) {
+            add(out.data(), out.data(), out.size(), low.data(), low.size());
+        }
+        out.resize(normalizedSize(out.data(), out.size()));
+    }
+
+    // Upper bound on the digits needed for an n-limb magnitude.
+    inline size_t maxDecimalDigits(size_t n) {
+        return n * 20 + 1;
+    }
+
+    inline char* writeChunk(char* out, Limb chunk, size_t width) {
+        char* end = out + width;
+        for (char* p = end; p != out;) {
+            *--p = char('0' + chunk % 10);
+            chunk /= 10;
+        }
+        return end;
+    }
+
+    inline char* writeChunk(char* out, Limb chunk) {
+        char tmp[DECIMAL_CHUNK_DIGITS + 1];
+        char* p = tmp + sizeof(tmp);
+        do {
+            *--p = char('0' + chunk % 10);
+            chunk /= 10;
+        } while (chunk != 0);
+        return std::copy(p, tmp + sizeof(tmp), out);
+    }
+
+    // Writes a[0 .. n) in decimal; width 0 means no padding, otherwise exactly width digits.
+    inline char* formatDecimalBasecase(char* out, const Limb* a, size_t n, size_t width) {
+        BIGINT_PROBE(FormatDecimalBasecase, n);
+        LimbBuffer rest(a, a + n);
+        LimbBuffer chunks;
+        n = normalizedSize(rest.data(), n);
+        while (n > 0) {
+            chunks.push_back(divRem1(rest.data(), rest.data(), n, DECIMAL_CHUNK));
+            n = normalizedSize(rest.data(), n);
+        }
+        if (width != 0) {
+            size_t used = chunks.size() * DECIMAL_CHUNK_DIGITS;
+            if (width > used) {
+                std::fill(out, out + (width - used), '0');
+                out += width - used;
+            }
+            for (size_t i = chunks.size(); i-- > 0;) out = writeChunk(out, chunks[i], DECIMAL_CHUNK_DIGITS);
+            return out;
+        }
+        if (chunks.empty()) {
+            *out++ = '0';
+            return out;
+        }
+        out = writeChunk(out, chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;) out = writeChunk(out, chunks[i], DECIMAL_CHUNK_DIGITS);
+        return out;
+    }
+
+    // Divide-and-conquer: split by the cached 10^(19 * 2^i), print the quotient, then the
+    // remainder padded to exactly 19 * 2^i digits.
+    inline char* formatDecimal(char* out, const Limb* a, size_t n, size_t width) {
+        n = normalizedSize(a, n);
+        if (n <= BIGINT_DECIMAL_DC_THRESHOLD) {
+            return formatDecimalBasecase(out, a, n, width);
+        }
+        size_t i = 0;
+        if (width != 0) {
+            while (decimalPowerDigits(i + 1) < width) ++i;
+        }
+        else {
+            while (decimalPower(i + 1).size() * 2 <= n + 1) ++i;
+        }
+        const LimbBuffer& power = decimalPower(i);
+        if (power.size() > n) {
+            return formatDecimalBasecase(out, a, n, width);
+        }
+        size_t lowDigits = decimalPowerDigits(i);
+        LimbBuffer q(n - power.size() + 1), r(power.size());
+        divRem(q.data(), r.data(), a, n, power.data(), power.size());
+        out = formatDecimal(out, q.data(), q.size(), width == 0 ? 0 : width - lowDigits);
+        return formatDecimal(out, r.data(), r.size(), lowDigits);
+    }
+}
@@ -0,0 +1,225 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include "Decimal.cpp"
+
+namespace mpn {
+
+    // The streaming reader parses 19 * 2^STREAM_BLOCK_LEVEL digits at a time; the writer hands
+    // its sink STREAM_WRITE_CHARS characters at a time.
+    const size_t STREAM_BLOCK_LEVEL = 12;
+    const size_t STREAM_WRITE_CHARS = size_t(1) << 16;
+
+    // 10^digits
+    inline LimbBuffer powerOfTen(size_t digits) {
+        Limb low = 1;
+        for (size_t i = 0; i < digits % DECIMAL_CHUNK_DIGITS; ++i) low *= 10;
+        LimbBuffer result(1, low);
+        size_t chunks = digits / DECIMAL_CHUNK_DIGITS;
+        for (size_t i = 0; chunks >> i != 0; ++i) {
+            if (((chunks >> i) & 1) == 0) continue;
+            const LimbBuffer& power = decimalPower(i);
+            LimbBuffer next(result.size() + power.size());
+            mul(next.data(), result.data(), result.size(), power.data(), power.size());
+            next.resize(normalizedSize(next.data(), next.size()));
+            result.swap(next);
+        }
+        return result;
+    }
+
+    // high = high * power + low, for low < power
+    inline void shiftInDecimal(LimbBuffer& high, const LimbBuffer& low, const LimbBuffer& power) {
+        LimbBuffer r(high.size() + power.size() + 1, 0);
+        if (!high.empty()) mul(r.data(), high.data(), high.size(), power.data(), power.size());
+        if (!low.empty()) add(r.data(), r.data(), r.size(), low.data(), low.size());
+        r.resize(normalizedSize(r.data(), r.size()));
+        high.swap(r);
+    }
+
+    // Parses one decimal number handed over in pieces of any size: optional whitespace, an
+    // optional sign, digits, optional whitespace. Full blocks of digits are parsed as they
+    // arrive and combined like a binary counter, two values of 19 * 2^k digits merging into one
+    // of twice that, so the text is never held beyond one block and the merges stay balanced.
+    class DecimalReader {
+    public:
+        DecimalReader() : state(Start), negative(false), blockDigits(decimalPowerDigits(STREAM_BLOCK_LEVEL)) {
+            block.reserve(blockDigits);
+        }
+
+        void feed(const char* text, size_t len) {
+            const char* end = text + len;
+            while (text != end) {
+                char c = *text;
+                bool digit = c >= '0' && c <= '9';
+                bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+                if (digit && state != Trailing) {
+                    state = Digits;
+                    const char* run = text;
+                    size_t room = blockDigits - block.size();
+                    while (run != end && size_t(run - text) < room && *run >= '0' && *run <= '9') ++run;
+                    block.append(text, run);
+                    text = run;
+                    if (block.size() == blockDigits) flushBlock();
+                    continue;
+                }
+                if (space && state != Sign) {
+                    if (state == Digits) state = Trailing;
+                }
+                else if ((c == '-' || c == '+') && state == Start) {
+                    negative = c == '-';
+                    state = Sign;
+                }
+                else {
+                    throw std::runtime_error("Invalid decimal digit");
+                }
+                ++text;
+            }
+        }
+
+        // Stores the magnitude parsed so far in out, most significant limb nonzero, and the
+        // sign in isNegative. The last combination is written straight into out.
+        template <class Limbs>
+        void finish(Limbs& out, bool& isNegative) {
+            if (state != Digits && state != Trailing) {
+                throw std::runtime_error("Invalid decimal digit");
+            }
+            LimbBuffer value;
+            if (!stack.empty()) {
+                value.swap(stack[0].value);
+                for (size_t i = 1; i < stack.size(); ++i) {
+                    shiftInDecimal(value, stack[i].value, decimalPower(stack[i].level));
+                }
+                stack.clear();
+            }
+            LimbBuffer tail;
+            parseDecimal(tail, block.data(), block.size());
+            LimbBuffer power = powerOfTen(block.size());
+            out.assign(value.size() + power.size() + 1, 0);
+            if (!value.empty()) mul(out.data(), value.data(), value.size(), power.data(), power.size());
+            if (!tail.empty()) add(out.data(), out.data(), out.size(), tail.data(), tail.size());
+            out.resize(normalizedSize(out.data(), out.size()));
+            isNegative = negative && out.size() != 0;
+        }
+
+    private:
+        enum State { Start, Sign, Digits, Trailing };
+
+        // value holds 19 * 2^level digits, leading zeros included
+        struct Segment {
+            LimbBuffer value;
+            size_t level;
+        };
+
+        State state;
+        bool negative;
+        const size_t blockDigits;             // 19 * 2^STREAM_BLOCK_LEVEL; capacity() may be larger
+        std::string block;
+        std::vector<Segment> stack;
+
+        void flushBlock() {
+            Segment segment;
+            segment.level = STREAM_BLOCK_LEVEL;
+            parseDecimal(segment.value, block.data(), block.size());
+            block.clear();
+            stack.push_back(std::move(segment));
+            while (stack.size() >= 2 && stack[stack.size() - 2].level == stack.back().level) {
+                Segment low = std::move(stack.back());
+                stack.pop_back();
+                shiftInDecimal(stack.back().value, low.value, decimalPower(low.level));
+                ++stack.back().level;
+            }
+        }
+    };
+
+    // Buffers characters and hands them to sink(const char*, size_t) in blocks.
+    template <class Sink>
+    class BlockWriter {
+    public:
+        explicit BlockWriter(Sink& sink) : sink(sink), buffer(STREAM_WRITE_CHARS), used(0) {
+        }
+
+        // Room for n <= STREAM_WRITE_CHARS characters; commit the end of what was written.
+        char* reserve(size_t n) {
+            if (used + n > buffer.size()) flush();
+            return buffer.data() + used;
+        }
+
+        void commit(char* end) {
+            used = size_t(end - buffer.data());
+        }
+
+        void fill(char c, size_t n) {
+            while (n > 0) {
+                size_t step = std::min(n, buffer.size());
+                char* out = reserve(step);
+                std::fill(out, out + step, c);
+                commit(out + step);
+                n -= step;
+            }
+        }
+
+        void flush() {
+            if (used != 0) sink(buffer.data(), used);
+            used = 0;
+        }
+
+    private:
+        Sink& sink;
+        std::vector<char> buffer;
+        size_t used;
+    };
+
+    // formatDecimalBasecase for a writer, with the zero padding streamed separately.
+    template <class Sink>
+    void writeDecimalBasecase(BlockWriter<Sink>& out, const Limb* a, size_t n, size_t width) {
+        LimbBuffer rest(a, a + n);
+        LimbBuffer chunks;
+        n = normalizedSize(rest.data(), n);
+        while (n > 0) {
+            chunks.push_back(divRem1(rest.data(), rest.data(), n, DECIMAL_CHUNK));
+            n = normalizedSize(rest.data(), n);
+        }
+        size_t i = chunks.size();
+        if (width != 0) {
+            size_t used = chunks.size() * DECIMAL_CHUNK_DIGITS;
+            if (width > used) out.fill('0', width - used);
+        }
+        else if (chunks.empty()) {
+            out.fill('0', 1);
+        }
+        else {
+            --i;
+            out.commit(writeChunk(out.reserve(DECIMAL_CHUNK_DIGITS), chunks[i]));
+        }
+        while (i-- > 0) out.commit(writeChunk(out.reserve(DECIMAL_CHUNK_DIGITS), chunks[i], DECIMAL_CHUNK_DIGITS));
+    }
+
+    // formatDecimal for a writer: the same splits, written out as the recursion produces them.
+    template <class Sink>
+    void writeDecimal(BlockWriter<Sink>& out, const Limb* a, size_t n, size_t width) {
+        n = normalizedSize(a, n);
+        if (n <= BIGINT_DECIMAL_DC_THRESHOLD) {
+            writeDecimalBasecase(out, a, n, width);
+            return;
+        }
+        size_t i = 0;
+        if (width != 0) {
+            while (decimalPowerDigits(i + 1) < width) ++i;
+        }
+        else {
+            while (decimalPower(i + 1).size() * 2 <= n + 1) ++i;
+        }
+        const LimbBuffer& power = decimalPower(i);
+        if (power.size() > n) {
+            writeDecimalBasecase(out, a, n, width);
+            return;
+        }
+        size_t lowDigits = decimalPowerDigits(i);
+        LimbBuffer q(n - power.size() + 1), r(power.size());
+        divRem(q.data(), r.data(), a, n, power.data(), power.size());
+        writeDecimal(out, q.data(), q.size(), width == 0 ? 0 : width - lowDigits);
+        LimbBuffer().swap(q);
+        writeDecimal(out, r.data(), r.size(), lowDigits);
+    }
+}
@@ -0,0 +1,329 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "Multiplication.cpp"
+
+// Divisors with at least this many limbs go through Burnikel-Ziegler.
+#ifndef BIGINT_DIV_DC_THRESHOLD
+#define BIGINT_DIV_DC_THRESHOLD 48
+#endif
+
+// Divisors and quotients both at least this long divide by multiplying with a Newton
+// reciprocal of the divisor; shorter reciprocals come from one division.
+#ifndef BIGINT_DIV_NEWTON_THRESHOLD
+#define BIGINT_DIV_NEWTON_THRESHOLD 65536
+#endif
+
+namespace mpn {
+
+    // Knuth, TAOCP vol. 2, 4.3.1, Algorithm D.
+    // q[0 .. an-dn] = a / d, r[0 .. dn) = a % d; dn >= 2, d[dn-1] != 0, an >= dn.
+    inline void divRemBasecase(Limb* q, Limb* r, const Limb* a, size_t an, const Limb* d, size_t dn) {
+        BIGINT_PROBE(DivBasecase, an + dn);
+        unsigned s = countLeadingZeros(d[dn - 1]);
+        LimbBuffer dnorm(dn);
+        LimbBuffer u(an + 1);
+        if (s != 0) {
+            lshift(dnorm.data(), d, dn, s);
+            u[an] = lshift(u.data(), a, an, s);
+        }
+        else {
+            std::copy(d, d + dn, dnorm.begin());
+            std::copy(a, a + an, u.begin());
+            u[an] = 0;
+        }
+        const Limb dtop = dnorm[dn - 1];
+        const Limb dnext = dnorm[dn - 2];
+
+        for (size_t j = an - dn + 1; j-- > 0;) {
+            Limb hi = u[j + dn];
+            Limb lo = u[j + dn - 1];
+            Limb qhat, rhat;
+            bool rhatOverflow = false;
+            if (hi >= dtop) {
+                qhat = ~Limb(0);
+                rhat = lo + dtop;
+                rhatOverflow = rhat < lo;
+            }
+            else {
+                qhat = divWide(hi, lo, dtop, rhat);
+            }
+            while (!rhatOverflow) {
+                Limb phi;
+                Limb plo = mulWide(qhat, dnext, phi);
+                if (phi < rhat || (phi == rhat && plo <= u[j + dn - 2])) break;
+                --qhat;
+                rhat += dtop;
+                rhatOverflow = rhat < dtop;
+            }
+
+            Limb borrow = subMul1(u.data() + j, dnorm.data(), dn, qhat);
+            Limb top = u[j + dn];
+            u[j + dn] = top - borrow;
+            if (top < borrow) {
+                --qhat;
+                u[j + dn] += addN(u.data() + j, u.data() + j, dnorm.data(), dn);
+            }
+            q[j] = qhat;
+        }
+
+        if (s != 0) rshift(r, u.data(), dn, s);
+        else std::copy(u.begin(), u.begin() + dn, r);
+    }
+
+    inline void divide2n1n(Limb* q, Limb* r, const Limb* a, const Limb* b, size_t n);
+
+    // a has 3h limbs, b has 2h limbs with the top bit set, a < b * B^h.
+    // q gets h limbs, r gets 2h limbs.
+    inline void divide3n2n(Limb* q, Limb* r, const Limb* a, const Limb* b, size_t h) {
+        const Limb* b1 = b + h;
+        const Limb* b2 = b;
+        LimbBuffer rr(2 * h + 1, 0);
+        if (cmp(a + 2 * h, b1, h) < 0) {
+            divide2n1n(q, rr.data() + h, a + h, b1, h);
+        }
+        else {
+            // a1 == b1 here, so [a1, a2] - b1 * B^h + b1 = a2 + b1
+            std::fill(q, q + h, ~Limb(0));
+            rr[2 * h] = addN(rr.data() + h, a + h, b1, h);
+        }
+        std::copy(a, a + h, rr.begin());
+
+        LimbBuffer d(2 * h);
+        mul(d.data(), q, h, b2, h);
+        Limb negative = sub(rr.data(), rr.data(), 2 * h + 1, d.data(), 2 * h);
+        while (negative) {
+            Limb one = 1;
+            sub(q, q, h, &one, 1);
+            negative = !add(rr.data(), rr.data(), 2 * h + 1, b, 2 * h);
+        }
+        std::copy(rr.begin(), rr.begin() + 2 * h, r);
+    }
+
+    // a has 2n limbs, b has n limbs with the top bit set, a < b * B^n.
+    // q gets n limbs, r gets n limbs.
+    inline void divide2n1n(Limb* q, Limb* r, const Limb* a, const Limb* b, size_t n) {
+        if (n == 1) {
+            q[0] = divWide(a[1], a[0], b[0], r[0]);
+            return;
+        }
+        if (n % 2 != 0 || n < BIGINT_DIV_DC_THRESHOLD) {
+            LimbBuffer qq(n + 1);
+            divRemBasecase(qq.data(), r, a, 2 * n, b, n);
+            std::copy(qq.begin(), qq.begin() + n, q);
+            return;
+        }
+        size_t h = n / 2;
+        LimbBuffer mid(3 * h);
+        std::copy(a, a + h, mid.begin());
+        divide3n2n(q + h, mid.data() + h, a + h, b, h);
+        divide3n2n(q, r, mid.data(), b, h);
+    }
+
+    // Burnikel-Ziegler, "Fast Recursive Division" (MPI-I-98-1-022).
+    // Same contract as divRemBasecase.
+    inline void divRemDivideAndConquer(Limb* q, Limb* r, const Limb* a, size_t an, const Limb* d, size_t dn) {
+        BIGINT_PROBE(DivDivideAndConquer, an + dn);
+        // Block size n = j * 2^k with j below the threshold, so the recursion bottoms out on whole blocks.
+        size_t m = 1;
+        while (dn > m * BIGINT_DIV_DC_THRESHOLD) m *= 2;
+        size_t j = (dn + m - 1) / m;
+        size_t n = j * m;
+        size_t pad = n - dn;
+        unsigned s = countLeadingZeros(d[dn - 1]);
+
+        LimbBuffer b(n, 0);
+        if (s != 0) lshift(b.data() + pad, d, dn, s);
+        else std::copy(d, d + dn, b.begin() + pad);
+
+        size_t len = an + pad + 1;
+        size_t t = (len + n - 1) / n;
+        LimbBuffer x((t + 1) * n, 0);
+        if (s != 0) x[an + pad] = lshift(x.data() + pad, a, an, s);
+        else std::copy(a, a + an, x.begin() + pad);
+        if (cmp(x.data() + (t - 1) * n, b.data(), n) >= 0) ++t;
+        if (t < 2) t = 2;
+
+        LimbBuffer z(2 * n);
+        LimbBuffer qq((t - 1) * n);
+        std::copy(x.begin() + (t - 2) * n, x.begin() + t * n, z.begin());
+        for (size_t i = t - 1; i-- > 0;) {
+            LimbBuffer rem(n);
+            divide2n1n(qq.data() + i * n, rem.data(), z.data(), b.data(), n);
+            if (i > 0) {
+                std::copy(x.begin() + (i - 1) * n, x.begin() + i * n, z.begin());
+            }
+            std::copy(rem.begin(), rem.end(), z.begin() + n);
+        }
+
+        size_t qn = an - dn + 1;
+        std::fill(q, q + qn, 0);
+        std::copy(qq.begin(), qq.begin() + std::min(qn, qq.size()), q);
+        if (s != 0) rshift(r, z.data() + n + pad, dn, s);
+        else std::copy(z.begin() + n + pad, z.begin() + n + pad + dn, r);
+    }
+
+    inline void divRem(Limb* q, Limb* r, const Limb* a, size_t an, const Limb* d, size_t dn);
+
+    // Moves x, within a few units of floor(B^(2n) / d), onto it.
+    inline void fixReciprocal(Limb* x, const Limb* d, size_t n) {
+        LimbBuffer p(2 * n + 1);
+        mul(p.data(), x, n + 1, d, n);
+        Limb one = 1;
+        while (p[2 * n] > 1 || (p[2 * n] == 1 && normalizedSize(p.data(), 2 * n) != 0)) {
+            sub(x, x, n + 1, &one, 1);
+            sub(p.data(), p.data(), 2 * n + 1, d, n);
+        }
+        if (p[2 * n] == 1) return;
+        negate(p.data(), 2 * n);                // B^(2n) - d * x
+        while (normalizedSize(p.data(), 2 * n) > n || cmp(p.data(), d, n) >= 0) {
+            add(x, x, n + 1, &one, 1);
+            sub(p.data(), p.data(), 2 * n, d, n);
+        }
+    }
+
+    // x[0 .. n] within three of floor(B^(2n) / d), for d of n limbs with the top bit set. The
+    // reciprocal of the top h = n/2 + 1 limbs of d, one limb more than half so that its error
+    // squares away, gives the top of x, and one Newton step
+    //     x = xh + xh * (B^(2n) - d * xh) / B^(2n)
+    // the rest.
+    inline void invertApproximate(Limb* x, const Limb* d, size_t n) {
+        if (n < BIGINT_DIV_NEWTON_THRESHOLD || n < 4) {
+            LimbBuffer power(2 * n + 1, 0), q(n + 2), r(n);
+            power[2 * n] = 1;
+            divRem(q.data(), r.data(), power.data(), 2 * n + 1, d, n);
+            std::copy(q.begin(), q.begin() + n + 1, x);
+            return;
+        }
+        size_t h = n / 2 + 1, k = n - h;
+        LimbBuffer xh(h + 1);
+        invertApproximate(xh.data(), d + k, h);
+
+        // e = B^(n+h) - d * xh, of either sign and within a few times B^n of zero
+        LimbBuffer e(n + h + 1);
+        mul(e.data(), d, n, xh.data(), h + 1);
+        bool negative = e[n + h] != 0;
+        if (negative) --e[n + h];
+        else negate(e.data(), n + h);
+        size_t en = normalizedSize(e.data(), n + h + 1);
+
+        // x = xh * B^k +- xh * e / B^(2h); the low h - 1 limbs of e cannot reach the units
+        std::fill(x, x + n + 1, 0);
+        std::copy(xh.begin(), xh.end(), x + k);
+        size_t drop = std::min(h - 1, en);
+        if (en > drop) {
+            LimbBuffer p(h + 1 + en - drop);
+            mul(p.data(), xh.data(), h + 1, e.data() + drop, en - drop);
+            size_t low = 2 * h - drop;
+            size_t pn = p.size() > low ? normalizedSize(p.data() + low, p.size() - low) : 0;
+            if (negative) sub(x, x, n + 1, p.data() + low, pn);
+            else add(x, x, n + 1, p.data() + low, pn);
+        }
+    }
+
+    // x[0 .. n] = floor(B^(2n) / d) for d of n limbs with the top bit set, so x[n] is 1 or 2:
+    // the Newton approximation, then one product with d to settle the last units.
+    inline void invert(Limb* x, const Limb* d, size_t n) {
+        invertApproximate(x, d, n);
+        if (n >= BIGINT_DIV_NEWTON_THRESHOLD && n >= 4) fixReciprocal(x, d, n);
+    }
+
+    // Barrett reduction of u[0 .. 2n) < d * B^n for d of n limbs with the top bit set and
+    // x = floor(B^(2n) / d): q[0 .. n) = u / d and u[0 .. n) = u % d. The quotient estimate
+    // x * (u >> 64n) >> 64n, one n-limb product since x[n] is 1 or 2, falls short by at most
+    // three; scratch holds 4n limbs.
+    inline void divide2n1nPreinverted(Limb* q, Limb* u, const Limb* d, const Limb* x, size_t n, Limb* scratch) {
+        Limb* ux = scratch;
+        Limb* qd = scratch + 2 * n;
+        mul(ux, u + n, n, x, n);
+        std::copy(ux + n, ux + 2 * n, q);
+        for (Limb i = 0; i < x[n]; ++i) addN(q, q, u + n, n);
+        mul(qd, q, n, d, n);
+        sub(u, u, 2 * n, qd, 2 * n);
+        Limb one = 1;
+        while (u[n] != 0 || cmp(u, d, n) >= 0) {
+            u[n] -= subN(u, u, d, n);
+            add(q, q, n, &one, 1);
+        }
+    }
+
+    // q[0 .. an-n] = a / d, r[0 .. n) = a % d, an >= n, given dNorm = d << s with its top bit
+    // set and x = floor(B^(2n) / dNorm). The shifted dividend is divided n limbs at a time
+    // from the top.
+    inline void divRemPreinverted(Limb* q, Limb* r, const Limb* a, size_t an,
+        const Limb* dNorm, unsigned s, const Limb* x, size_t n) {
+        LimbBuffer buffer(an + 1 + 7 * n, 0);
+        Limb* u = buffer.data();
+        Limb* work = u + an + 1;
+        Limb* qb = work + 2 * n;
+        Limb* scratch = qb + n;
+        if (s != 0) u[an] = lshift(u, a, an, s);
+        else std::copy(a, a + an, u);
+        size_t len = an + (u[an] != 0);
+        size_t qn = an - n + 1;
+        std::fill(q, q + qn, 0);
+
+        // the top block, below 2 * dNorm, starts the remainder in the high half of work
+        size_t blocks = (len + n - 1) / n;
+        size_t top = (blocks - 1) * n;
+        std::copy(u + top, u + len, work + n);
+        if (len - top == n && cmp(work + n, dNorm, n) >= 0) {
+            subN(work + n, work + n, dNorm, n);
+            q[top] = 1;
+        }
+        for (size_t b = blocks - 1; b-- > 0;) {
+            std::copy(u + b * n, u + b * n + n, work);
+            divide2n1nPreinverted(qb, work, dNorm, x, n, scratch);
+            std::copy(qb, qb + std::min(n, qn - std::min(qn, b * n)), q + b * n);
+            std::copy(work, work + n, work + n);
+        }
+        if (s != 0) rshift(r, work + n, n, s);
+        else std::copy(work + n, work + 2 * n, r);
+    }
+
+    // Same contract as divRemBasecase. The divisor's reciprocal costs a few products and each
+    // n-limb block of quotient two more. A quotient shorter than the divisor is estimated
+    // from the top qn + 1 limbs of the divisor, at most two above the true one, and corrected
+    // with one product.
+    inline void divRemNewton(Limb* q, Limb* r, const Limb* a, size_t an, const Limb* d, size_t dn) {
+        BIGINT_PROBE(DivNewton, an + dn);
+        size_t qn = an - dn + 1;
+        if (qn + 1 < dn) {
+            size_t skip = dn - (qn + 1);
+            LimbBuffer rt(qn + 1);
+            divRem(q, rt.data(), a + skip, an - skip, d + skip, qn + 1);
+            LimbBuffer p(an + 1);
+            mul(p.data(), q, qn, d, dn);
+            Limb one = 1;
+            while (p[an] != 0 || cmp(p.data(), a, an) > 0) {
+                sub(q, q, qn, &one, 1);
+                sub(p.data(), p.data(), an + 1, d, dn);
+            }
+            sub(p.data(), a, an, p.data(), an);
+            std::copy(p.begin(), p.begin() + dn, r);
+            return;
+        }
+        unsigned s = countLeadingZeros(d[dn - 1]);
+        LimbBuffer dNorm(dn), x(dn + 1);
+        if (s != 0) lshift(dNorm.data(), d, dn, s);
+        else std::copy(d, d + dn, dNorm.begin());
+        invert(x.data(), dNorm.data(), dn);
+        divRemPreinverted(q, r, a, an, dNorm.data(), s, x.data(), dn);
+    }
+
+    // q[0 .. an-dn] = a / d, r[0 .. dn) = a % d; d[dn-1] != 0, an >= dn.
+    inline void divRem(Limb* q, Limb* r, const Limb* a, size_t an, const Limb* d, size_t dn) {
+        if (dn == 1) {
+            r[0] = divRem1(q, a, an, d[0]);
+        }
+        else if (dn < BIGINT_DIV_DC_THRESHOLD || an - dn < BIGINT_DIV_DC_THRESHOLD) {
+            divRemBasecase(q, r, a, an, d, dn);
+        }
+        else if (dn < BIGINT_DIV_NEWTON_THRESHOLD || an - dn < BIGINT_DIV_NEWTON_THRESHOLD) {
+            divRemDivideAndConquer(q, r, a, an, d, dn);
+        }
+        else {
+            divRemNewton(q, r, a, an, d, dn);
+        }
+    }
+}
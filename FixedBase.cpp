@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <stdexcept>
+#include "BigInt.cpp"
+
+// base^e mod |m| for one base and modulus and many exponents, from comb tables built once
+// (mpn::FixedBaseComb). teeth and tables trade memory for speed: tables * 2^teeth residues
+// make an exponent of maxExponentBits cost about maxExponentBits / (teeth * tables)
+// squarings and maxExponentBits / teeth products. Longer exponents still work, through the
+// ordinary sliding window.
+class FixedBasePowMod {
+public:
+    FixedBasePowMod(const BigInt& base, const BigInt& m, size_t maxExponentBits, unsigned teeth = 8,
+        unsigned tables = 1) {
+        if (m.limbs.empty()) {
+            throw std::runtime_error("Division by zero");
+        }
+        if (m.limbs[0] & 1) {
+            montgomery.reset(new MontgomeryContext(m.limbs));
+            build(base, maxExponentBits, teeth, tables, *montgomery);
+        }
+        else {
+            barrett.reset(new BarrettContext(m.limbs));
+            build(base, maxExponentBits, teeth, tables, *barrett);
+        }
+    }
+
+    size_t maxExponentBits() const { return comb.maxBits(); }
+
+    BigInt pow(const BigInt& e) const {
+        BigInt::checkExponent(e);
+        return montgomery ? pow(e, *montgomery) : pow(e, *barrett);
+    }
+
+private:
+    std::unique_ptr<MontgomeryContext> montgomery;
+    std::unique_ptr<BarrettContext> barrett;
+    mpn::FixedBaseComb comb;
+
+    template <class Context>
+    void build(const BigInt& base, size_t bits, unsigned teeth, unsigned tables, const Context& ctx) {
+        LimbBuffer b = base.residue(ctx);
+        LimbBuffer scratch(ctx.scratchSize());
+        BigInt::toResidueForm(b.data(), ctx, scratch.data());
+        comb = mpn::FixedBaseComb(b.data(), bits, teeth, tables, ctx);
+    }
+
+    template <class Context>
+    BigInt pow(const BigInt& e, const Context& ctx) const {
+        BIGINT_PROBE(PowMod, ctx.size() + e.limbs.size());
+        LimbBuffer r(ctx.size());
+        LimbBuffer scratch(ctx.scratchSize());
+        if (mpn::bitLength(e.limbs.data(), e.limbs.size()) <= comb.maxBits()) {
+            comb.pow(r.data(), e.limbs.data(), e.limbs.size(), ctx);
+        }
+        else {
+            mpn::powModSlidingWindow(r.data(), comb.base(), e.limbs.data(), e.limbs.size(), ctx);
+        }
+        BigInt::fromResidueForm(r.data(), ctx, scratch.data());
+        return BigInt::fromLimbs(r.data(), r.size());
+    }
+};
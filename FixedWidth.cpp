@@ -0,0 +1,404 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+#include "BigInt.cpp"
+
+// Fixed-width unsigned integers for sizes known at compile time (256, 384, 2048, 4096 bits):
+// the limbs live inline, nothing is normalized, and every operation runs a constant number of
+// limb steps that the compiler can unroll. All of it is constexpr, so moduli and the
+// Montgomery constants derived from them can be computed at compile time.
+
+// Unrolls the constant-count limb loops, completely up to 512 bits, where the compiler takes a hint.
+#if defined(__clang__)
+#define BIGINT_UNROLL _Pragma("unroll 8")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define BIGINT_UNROLL _Pragma("GCC unroll 8")
+#else
+#define BIGINT_UNROLL
+#endif
+
+namespace mpn {
+    namespace fixed {
+
+        // mulWide, in a form that can run in a constant expression
+        constexpr Limb mulWide(Limb a, Limb b, Limb& hi) {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 p = (unsigned __int128)a * b;
+            hi = (Limb)(p >> 64);
+            return (Limb)p;
+#else
+            Limb al = a & 0xffffffffu, ah = a >> 32;
+            Limb bl = b & 0xffffffffu, bh = b >> 32;
+            Limb ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+            Limb mid = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+            hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+            return (mid << 32) | (ll & 0xffffffffu);
+#endif
+        }
+
+        // a * b + c + d, which always fits in two limbs
+        constexpr Limb mulAdd(Limb a, Limb b, Limb c, Limb d, Limb& hi) {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 p = (unsigned __int128)a * b + c + d;
+            hi = (Limb)(p >> 64);
+            return (Limb)p;
+#else
+            Limb lo = mulWide(a, b, hi);
+            lo += c;
+            hi += lo < c;
+            lo += d;
+            hi += lo < d;
+            return lo;
+#endif
+        }
+
+        // a + b + carry, carry in and out in {0, 1}
+        constexpr Limb addCarry(Limb a, Limb b, Limb& carry) {
+            Limb s = a + carry;
+            Limb c = s < carry;
+            s += b;
+            carry = c + (s < b);
+            return s;
+        }
+
+        // a - b - borrow, borrow in and out in {0, 1}
+        constexpr Limb subBorrow(Limb a, Limb b, Limb& borrow) {
+            Limb d = a - b;
+            Limb b1 = a < b;
+            Limb r = d - borrow;
+            borrow = b1 | (d < borrow);
+            return r;
+        }
+    }
+}
+
+template <size_t Bits>
+class BigUInt {
+    static_assert(Bits > 0 && Bits % 64 == 0, "BigUInt width must be a positive multiple of 64 bits");
+
+public:
+    static constexpr size_t LIMBS = Bits / 64;
+
+    constexpr BigUInt() : w{} {
+    }
+
+    constexpr explicit BigUInt(Limb value) : w{ value } {
+    }
+
+    // Throws unless value is non-negative and fits in Bits bits.
+    explicit BigUInt(const BigInt& value) : w{} {
+        BigIntView v = value.view();
+        if (v.negative() || v.size() > LIMBS) {
+            throw std::runtime_error("Value does not fit in BigUInt");
+        }
+        for (size_t i = 0; i < v.size(); ++i) w[i] = v.data()[i];
+    }
+
+    BigInt toBigInt() const {
+        return BigInt(BigIntView(w, LIMBS, false));
+    }
+
+    // Hexadecimal digits, optionally prefixed by 0x; usable in constant expressions.
+    static constexpr BigUInt fromHex(const char* text) {
+        BigUInt r;
+        if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) text += 2;
+        if (*text == '\0') throw std::runtime_error("Invalid hexadecimal digit");
+        for (; *text != '\0'; ++text) {
+            char c = *text;
+            Limb digit = c >= '0' && c <= '9' ? Limb(c - '0')
+                : c >= 'a' && c <= 'f' ? Limb(c - 'a' + 10)
+                : c >= 'A' && c <= 'F' ? Limb(c - 'A' + 10) : 16;
+            if (digit == 16) throw std::runtime_error("Invalid hexadecimal digit");
+            if (r.w[LIMBS - 1] >> 60 != 0) throw std::runtime_error("Value does not fit in BigUInt");
+            r <<= 4;
+            r.w[0] |= digit;
+        }
+        return r;
+    }
+
+    // Decimal digits; usable in constant expressions.
+    static constexpr BigUInt fromDecimal(const char* text) {
+        BigUInt r;
+        if (*text == '\0') throw std::runtime_error("Invalid decimal digit");
+        for (; *text != '\0'; ++text) {
+            if (*text < '0' || *text > '9') throw std::runtime_error("Invalid decimal digit");
+            Limb carry = Limb(*text - '0');
+            for (size_t i = 0; i < LIMBS; ++i) r.w[i] = mpn::fixed::mulAdd(r.w[i], 10, carry, 0, carry);
+            if (carry != 0) throw std::runtime_error("Value does not fit in BigUInt");
+        }
+        return r;
+    }
+
+    constexpr Limb operator[](size_t i) const { return w[i]; }
+    constexpr Limb& operator[](size_t i) { return w[i]; }
+    const Limb* data() const { return w; }
+    Limb* data() { return w; }
+
+    constexpr bool isZero() const {
+        Limb any = 0;
+        for (size_t i = 0; i < LIMBS; ++i) any |= w[i];
+        return any == 0;
+    }
+
+    constexpr bool bit(size_t i) const {
+        return (w[i / 64] >> (i % 64)) & 1;
+    }
+
+    constexpr size_t bitLength() const {
+        for (size_t i = LIMBS; i-- > 0;) {
+            if (w[i] != 0) return i * 64 + 64 - countLeadingZeros(w[i]);
+        }
+        return 0;
+    }
+
+    // count <= 64 bits starting at bit pos, zero beyond the top
+    constexpr Limb bits(size_t pos, unsigned count) const {
+        size_t i = pos / 64, shift = pos % 64;
+        Limb x = w[i] >> shift;
+        if (shift != 0 && i + 1 < LIMBS) x |= w[i + 1] << (64 - shift);
+        return count == 64 ? x : x & ((Limb(1) << count) - 1);
+    }
+
+    // r = a + b mod 2^Bits, returns the carry out
+    static constexpr Limb add(BigUInt& r, const BigUInt& a, const BigUInt& b) {
+        Limb carry = 0;
+        BIGINT_UNROLL for (size_t i = 0; i < LIMBS; ++i) r.w[i] = mpn::fixed::addCarry(a.w[i], b.w[i], carry);
+        return carry;
+    }
+
+    // r = a - b mod 2^Bits, returns the borrow out
+    static constexpr Limb sub(BigUInt& r, const BigUInt& a, const BigUInt& b) {
+        Limb borrow = 0;
+        BIGINT_UNROLL for (size_t i = 0; i < LIMBS; ++i) r.w[i] = mpn::fixed::subBorrow(a.w[i], b.w[i], borrow);
+        return borrow;
+    }
+
+    // Arithmetic wraps modulo 2^Bits like the built-in unsigned types; mulFull keeps every bit
+    // of a product.
+    constexpr BigUInt& operator+=(const BigUInt& other) {
+        add(*this, *this, other);
+        return *this;
+    }
+
+    constexpr BigUInt& operator-=(const BigUInt& other) {
+        sub(*this, *this, other);
+        return *this;
+    }
+
+    constexpr BigUInt& operator*=(const BigUInt& other) {
+        *this = *this * other;
+        return *this;
+    }
+
+    friend constexpr BigUInt operator+(BigUInt a, const BigUInt& b) { return a += b; }
+    friend constexpr BigUInt operator-(BigUInt a, const BigUInt& b) { return a -= b; }
+
+    // low Bits bits of a * b; only the limb products that land there are formed
+    friend constexpr BigUInt operator*(const BigUInt& a, const BigUInt& b) {
+        BigUInt r;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            Limb carry = 0;
+            BIGINT_UNROLL for (size_t j = 0; i + j < LIMBS; ++j) {
+                r.w[i + j] = mpn::fixed::mulAdd(a.w[i], b.w[j], r.w[i + j], carry, carry);
+            }
+        }
+        return r;
+    }
+
+    constexpr BigUInt& operator<<=(size_t shift) {
+        if (shift >= Bits) return *this = BigUInt();
+        size_t limbShift = shift / 64, bitShift = shift % 64;
+        for (size_t i = LIMBS; i-- > 0;) {
+            Limb x = i >= limbShift ? w[i - limbShift] << bitShift : 0;
+            if (bitShift != 0 && i > limbShift) x |= w[i - limbShift - 1] >> (64 - bitShift);
+            w[i] = x;
+        }
+        return *this;
+    }
+
+    constexpr BigUInt& operator>>=(size_t shift) {
+        if (shift >= Bits) return *this = BigUInt();
+        size_t limbShift = shift / 64, bitShift = shift % 64;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            Limb x = i + limbShift < LIMBS ? w[i + limbShift] >> bitShift : 0;
+            if (bitShift != 0 && i + limbShift + 1 < LIMBS) x |= w[i + limbShift + 1] << (64 - bitShift);
+            w[i] = x;
+        }
+        return *this;
+    }
+
+    friend constexpr BigUInt operator<<(BigUInt a, size_t shift) { return a <<= shift; }
+    friend constexpr BigUInt operator>>(BigUInt a, size_t shift) { return a >>= shift; }
+
+    friend constexpr BigUInt operator&(BigUInt a, const BigUInt& b) {
+        for (size_t i = 0; i < LIMBS; ++i) a.w[i] &= b.w[i];
+        return a;
+    }
+
+    friend constexpr BigUInt operator|(BigUInt a, const BigUInt& b) {
+        for (size_t i = 0; i < LIMBS; ++i) a.w[i] |= b.w[i];
+        return a;
+    }
+
+    friend constexpr BigUInt operator^(BigUInt a, const BigUInt& b) {
+        for (size_t i = 0; i < LIMBS; ++i) a.w[i] ^= b.w[i];
+        return a;
+    }
+
+    friend constexpr BigUInt operator~(BigUInt a) {
+        for (size_t i = 0; i < LIMBS; ++i) a.w[i] = ~a.w[i];
+        return a;
+    }
+
+    // -1, 0 or 1 as a is below, equal to or above b
+    friend constexpr int compare(const BigUInt& a, const BigUInt& b) {
+        for (size_t i = LIMBS; i-- > 0;) {
+            if (a.w[i] != b.w[i]) return a.w[i] > b.w[i] ? 1 : -1;
+        }
+        return 0;
+    }
+
+    friend constexpr bool operator==(const BigUInt& a, const BigUInt& b) { return compare(a, b) == 0; }
+    friend constexpr bool operator!=(const BigUInt& a, const BigUInt& b) { return compare(a, b) != 0; }
+    friend constexpr bool operator<(const BigUInt& a, const BigUInt& b) { return compare(a, b) < 0; }
+    friend constexpr bool operator>(const BigUInt& a, const BigUInt& b) { return compare(a, b) > 0; }
+    friend constexpr bool operator<=(const BigUInt& a, const BigUInt& b) { return compare(a, b) <= 0; }
+    friend constexpr bool operator>=(const BigUInt& a, const BigUInt& b) { return compare(a, b) >= 0; }
+
+private:
+    Limb w[LIMBS];
+
+    static constexpr int countLeadingZeros(Limb x) {
+        int n = 0;
+        for (Limb top = Limb(1) << 63; (x & top) == 0; x <<= 1) ++n;
+        return n;
+    }
+};
+
+template <size_t Bits>
+constexpr size_t BigUInt<Bits>::LIMBS;
+
+// Full product a * b, A + B bits wide.
+template <size_t A, size_t B>
+constexpr BigUInt<A + B> mulFull(const BigUInt<A>& a, const BigUInt<B>& b) {
+    BigUInt<A + B> r;
+    for (size_t i = 0; i < BigUInt<A>::LIMBS; ++i) {
+        Limb carry = 0;
+        BIGINT_UNROLL for (size_t j = 0; j < BigUInt<B>::LIMBS; ++j) {
+            r[i + j] = mpn::fixed::mulAdd(a[i], b[j], r[i + j], carry, carry);
+        }
+        r[i + BigUInt<B>::LIMBS] = carry;
+    }
+    return r;
+}
+
+// MontgomeryContext for one fixed width, R = 2^Bits. The modulus must be odd; products run
+// CIOS over a stack buffer, so a context is a literal value that can be a constexpr constant.
+template <size_t Bits>
+class FixedMontgomery {
+public:
+    typedef BigUInt<Bits> Value;
+    static constexpr size_t LIMBS = Value::LIMBS;
+
+    constexpr explicit FixedMontgomery(const Value& modulus) : mod(modulus), nPrime(0), rModN(), r2ModN() {
+        if ((mod[0] & 1) == 0) {
+            throw std::runtime_error("Montgomery modulus must be odd");
+        }
+        Limb inv = mod[0];                      // Newton iteration for N^-1 mod 2^64
+        for (int i = 0; i < 6; ++i) inv *= 2 - mod[0] * inv;
+        nPrime = ~inv + 1;
+
+        // R mod N by doubling the top power of two below N; then B * R mod N, which is B in
+        // Montgomery form, raised to the limb count in Montgomery form gives R^2 mod N.
+        size_t top = mod.bitLength() - 1;
+        rModN = top == 0 ? Value() : Value(1) << top;
+        for (size_t i = top; i < Bits; ++i) rModN = doubleMod(rModN);
+        Value b = rModN;
+        for (int i = 0; i < 64; ++i) b = doubleMod(b);
+        r2ModN = rModN;
+        for (size_t k = LIMBS; k != 0; k >>= 1) {
+            if (k & 1) r2ModN = mul(r2ModN, b);
+            if (k > 1) b = mul(b, b);
+        }
+    }
+
+    constexpr const Value& modulus() const { return mod; }
+    constexpr Limb n0() const { return nPrime; }  // -N^-1 mod B
+    constexpr const Value& rSquared() const { return r2ModN; }
+    constexpr const Value& one() const { return rModN; }  // 1 in Montgomery form
+
+    // a * b * R^-1 mod N for a * b < N * R, so either operand may be any Bits-bit value if
+    // the other is below N.
+    constexpr Value mul(const Value& a, const Value& b) const {
+        Limb t[LIMBS + 2] = {};
+        for (size_t i = 0; i < LIMBS; ++i) {
+            Limb carry = 0;
+            BIGINT_UNROLL for (size_t j = 0; j < LIMBS; ++j) t[j] = mpn::fixed::mulAdd(a[j], b[i], t[j], carry, carry);
+            t[LIMBS] += carry;
+            t[LIMBS + 1] = t[LIMBS] < carry;
+
+            Limb m = t[0] * nPrime;
+            mpn::fixed::mulAdd(m, mod[0], t[0], 0, carry);
+            BIGINT_UNROLL for (size_t j = 1; j < LIMBS; ++j) t[j - 1] = mpn::fixed::mulAdd(m, mod[j], t[j], carry, carry);
+            t[LIMBS - 1] = t[LIMBS] + carry;
+            t[LIMBS] = t[LIMBS + 1] + (t[LIMBS - 1] < carry);
+        }
+        Value r;
+        for (size_t i = 0; i < LIMBS; ++i) r[i] = t[i];
+        if (t[LIMBS] != 0 || r >= mod) Value::sub(r, r, mod);
+        return r;
+    }
+
+    constexpr Value sqr(const Value& a) const {
+        return mul(a, a);
+    }
+
+    // a * R mod N for any a
+    constexpr Value toMontgomery(const Value& a) const {
+        return mul(a, r2ModN);
+    }
+
+    // a * R^-1 mod N
+    constexpr Value fromMontgomery(const Value& a) const {
+        return mul(a, Value(1));
+    }
+
+    // base^exponent mod N with fixed windows, 4 bits wide up to 512-bit moduli and 5 above;
+    // base and result in the usual form.
+    template <size_t E>
+    constexpr Value pow(const Value& base, const BigUInt<E>& exponent) const {
+        Value table[1 << WINDOW_BITS];
+        table[0] = rModN;
+        table[1] = toMontgomery(base);
+        for (int i = 2; i < 1 << WINDOW_BITS; ++i) table[i] = mul(table[i - 1], table[1]);
+        Value r = rModN;
+        size_t windows = (exponent.bitLength() + WINDOW_BITS - 1) / WINDOW_BITS;
+        for (size_t i = windows; i-- > 0;) {
+            for (unsigned j = 0; j < WINDOW_BITS && i + 1 != windows; ++j) r = sqr(r);
+            r = mul(r, table[exponent.bits(WINDOW_BITS * i, WINDOW_BITS)]);
+        }
+        return fromMontgomery(r);
+    }
+
+private:
+    static constexpr unsigned WINDOW_BITS = Bits > 512 ? 5 : 4;
+
+    Value mod;
+    Limb nPrime;
+    Value rModN;
+    Value r2ModN;
+
+    // 2a mod N for a < N
+    constexpr Value doubleMod(const Value& a) const {
+        Limb top = a[LIMBS - 1] >> 63;
+        Value r = a << 1;
+        if (top != 0 || r >= mod) Value::sub(r, r, mod);
+        return r;
+    }
+};
+
+template <size_t Bits>
+constexpr size_t FixedMontgomery<Bits>::LIMBS;
+
+template <size_t Bits>
+constexpr unsigned FixedMontgomery<Bits>::WINDOW_BITS;
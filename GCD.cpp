@@ -0,0 +1,181 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "Division.cpp"
+#include "Bitwise.cpp"
+
+namespace mpn {
+
+    // Stein's binary GCD, used once both operands fit in a word.
+    inline Limb gcdWord(Limb a, Limb b) {
+        if (a == 0) return b;
+        if (b == 0) return a;
+        int shift = countTrailingZeros(a | b);
+        a >>= countTrailingZeros(a);
+        do {
+            b >>= countTrailingZeros(b);
+            if (a > b) std::swap(a, b);
+            b -= a;
+        } while (b != 0);
+        return a << shift;
+    }
+
+    // Width of the leading digits Lehmer's algorithm simulates Euclid on, small enough that
+    // every intermediate of Algorithm L fits a signed 64-bit word.
+    const unsigned LEHMER_BITS = 62;
+
+    // Bits [low, low + LEHMER_BITS) of x
+    inline long long leadingBits(const Limb* x, size_t n, size_t low) {
+        size_t word = low / LIMB_BITS;
+        unsigned shift = low % LIMB_BITS;
+        Limb bits = word < n ? x[word] >> shift : 0;
+        if (shift != 0 && word + 1 < n) bits |= x[word + 1] << (LIMB_BITS - shift);
+        return (long long)(bits & ((Limb(1) << LEHMER_BITS) - 1));
+    }
+
+    // (u, v) -> (a*u + b*v, c*u + d*v) after `steps` Euclidean steps.
+    struct LehmerMatrix {
+        long long a, b, c, d;
+        size_t steps;
+    };
+
+    // x - q*y in wrapping arithmetic; the true result always fits, the product may not.
+    inline long long mulSub(long long x, long long q, long long y) {
+        return (long long)(Limb(x) - Limb(q) * Limb(y));
+    }
+
+    // Knuth, TAOCP vol. 2, 4.5.2, Algorithm L: runs Euclid on the leading digits uh >= vh while
+    // both bounds on each quotient agree, so every step taken is one the full operands would take.
+    inline LehmerMatrix lehmerMatrix(long long uh, long long vh) {
+        LehmerMatrix m = { 1, 0, 0, 1, 0 };
+        while (vh + m.c > 0 && vh + m.d > 0) {
+            long long q = (uh + m.a) / (vh + m.c);
+            if (q != (uh + m.b) / (vh + m.d)) break;
+            long long t = mulSub(m.a, q, m.c);
+            m.a = m.c;
+            m.c = t;
+            t = mulSub(m.b, q, m.d);
+            m.b = m.d;
+            m.d = t;
+            t = mulSub(uh, q, vh);
+            uh = vh;
+            vh = t;
+            ++m.steps;
+        }
+        return m;
+    }
+
+    // r[0 .. n) = p*x + q*y for a matrix row, whose entries never share a sign and whose
+    // result is known to be non-negative and no larger than x.
+    inline void lehmerCombine(Limb* r, const Limb* x, const Limb* y, size_t n, long long p, long long q) {
+        if (p > 0) {
+            mul1(r, x, n, Limb(p));
+            subMul1(r, y, n, Limb(-q));
+        }
+        else {
+            mul1(r, y, n, Limb(q));
+            subMul1(r, x, n, Limb(-p));
+        }
+    }
+
+    // r[0 .. n] = |p|*x + |q|*y; Euclid's cofactors alternate in sign, so their magnitudes add.
+    inline void cofactorCombine(Limb* r, const Limb* x, const Limb* y, size_t n, long long p, long long q) {
+        r[n] = mul1(r, x, n, Limb(p < 0 ? -p : p));
+        r[n] += addMul1(r, y, n, Limb(q < 0 ? -q : q));
+    }
+
+    // g = gcd(a, b); returns the size of g, which needs max(an, bn) limbs.
+    // When s is not null it receives the cofactor of a that the Euclidean remainder sequence
+    // b, a, b mod a, ... ends with: s*a = g (mod b), |s| in s[0 .. sn), s needs an + bn + 2 limbs.
+    // Quotients come from Lehmer steps on the leading 62 bits, with a full division only when
+    // those bits cannot decide one.
+    inline size_t gcdExt(Limb* g, Limb* s, size_t& sn, bool& sNegative,
+        const Limb* a, size_t an, const Limb* b, size_t bn) {
+        BIGINT_PROBE(GcdLehmer, an + bn);
+        an = normalizedSize(a, an);
+        bn = normalizedSize(b, bn);
+        size_t n = std::max(an, bn) + 1;
+        LimbBuffer r0(n, 0), r1(n, 0), t0(n), t1(n);
+        std::copy(b, b + bn, r0.begin());
+        std::copy(a, a + an, r1.begin());
+        size_t n0 = bn, n1 = an;
+
+        // u0, u1 are the cofactors of r0, r1 over un limbs; u1Negative is the sign of u1 and u0
+        // has the other one.
+        size_t cap = an + bn + 2;
+        LimbBuffer u0(cap, 0), u1(cap, 0), w0(cap, 0), w1(cap, 0);
+        size_t un = 1;
+        u1[0] = 1;
+        bool u1Negative = false;
+
+        if (n0 < n1 || (n0 == n1 && cmp(r0.data(), r1.data(), n0) < 0)) {
+            std::swap(r0, r1);
+            std::swap(n0, n1);
+            std::swap(u0, u1);
+            u1Negative = true;
+        }
+
+        while (n1 != 0) {
+            if (n0 == 1 && s == nullptr) {
+                g[0] = gcdWord(r0[0], r1[0]);
+                return 1;
+            }
+            LehmerMatrix m = { 1, 0, 0, 1, 0 };
+            if (n0 >= 2) {
+                size_t low = bitLength(r0.data(), n0) - LEHMER_BITS;
+                m = lehmerMatrix(leadingBits(r0.data(), n0, low), leadingBits(r1.data(), n0, low));
+            }
+
+            if (m.steps == 0) {
+                // t1 = r0 mod r1, t0 = r0 / r1
+                divRem(t0.data(), t1.data(), r0.data(), n0, r1.data(), n1);
+                if (s != nullptr) {
+                    size_t qn = normalizedSize(t0.data(), n0 - n1 + 1);
+                    std::fill(w0.begin(), w0.end(), 0);
+                    mul(w0.data(), t0.data(), qn, u1.data(), un);
+                    add(w0.data(), w0.data(), qn + un, u0.data(), un);
+                    un = normalizedSize(w0.data(), qn + un);
+                    std::swap(u0, u1);
+                    std::swap(u1, w0);
+                    u1Negative = !u1Negative;
+                }
+                std::swap(r0, r1);
+                std::swap(r1, t1);
+                n0 = n1;
+                n1 = normalizedSize(r1.data(), n0);
+                continue;
+            }
+
+            lehmerCombine(t0.data(), r0.data(), r1.data(), n0, m.a, m.b);
+            lehmerCombine(t1.data(), r0.data(), r1.data(), n0, m.c, m.d);
+            std::swap(r0, t0);
+            std::swap(r1, t1);
+            n1 = normalizedSize(r1.data(), n0);
+            n0 = normalizedSize(r0.data(), n0);
+            if (s != nullptr) {
+                cofactorCombine(w0.data(), u0.data(), u1.data(), un, m.a, m.b);
+                cofactorCombine(w1.data(), u0.data(), u1.data(), un, m.c, m.d);
+                un = std::max(normalizedSize(w0.data(), un + 1), normalizedSize(w1.data(), un + 1));
+                std::fill(w0.begin() + un, w0.end(), 0);
+                std::fill(w1.begin() + un, w1.end(), 0);
+                std::swap(u0, w0);
+                std::swap(u1, w1);
+                if (m.steps & 1) u1Negative = !u1Negative;
+            }
+        }
+
+        std::copy(r0.begin(), r0.begin() + n0, g);
+        if (s != nullptr) {
+            sn = normalizedSize(u0.data(), un);
+            std::copy(u0.begin(), u0.begin() + sn, s);
+            sNegative = !u1Negative && sn != 0;
+        }
+        return n0;
+    }
+
+    inline size_t gcd(Limb* g, const Limb* a, size_t an, const Limb* b, size_t bn) {
+        size_t sn;
+        bool sNegative;
+        return gcdExt(g, nullptr, sn, sNegative, a, an, b, bn);
+    }
+}
@@ -0,0 +1,297 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// Opt-in counters: build with -DBIGINT_INSTRUMENT and every BigInt operation and algorithm
+// variant records its calls, the limbs it was given and the time spent in it, and BigInt
+// storage records its heap allocations. Without the macro the probes compile to nothing and
+// snapshots stay empty.
+#ifdef BIGINT_INSTRUMENT
+#define BIGINT_PROBE(probe, limbs) instrumentation::ProbeScope bigintProbe(instrumentation::probe, limbs)
+#define BIGINT_RECORD_ALLOCATION(bytes) instrumentation::recordAllocation(bytes)
+#define BIGINT_RECORD_FREE(bytes) instrumentation::recordFree(bytes)
+#else
+#define BIGINT_PROBE(probe, limbs) ((void)0)
+#define BIGINT_RECORD_ALLOCATION(bytes) ((void)0)
+#define BIGINT_RECORD_FREE(bytes) ((void)0)
+#endif
+
+namespace instrumentation {
+
+    enum Probe {
+        // BigInt operations
+        Add, Subtract, Multiply, Divide, Shift, Bitwise, Gcd, ExtendedGcd, ModInverse, Power, PowMod,
+        Root, Prime, ToString, Parse,
+        // algorithm variants underneath them
+        MulBasecase, MulKaratsuba, MulToom3, MulNtt, DivRem1, DivBasecase, DivDivideAndConquer, DivNewton,
+        GcdLehmer, PowModSlidingWindow, PowModFixedWindow, PowModLanes, PowModComb, PowModStraus,
+        PowModPippenger, MillerRabin, StrongLucas, FormatDecimalBasecase, ParseDecimalBasecase,
+        PROBE_COUNT
+    };
+
+    inline const char* probeName(Probe probe) {
+        static const char* const names[PROBE_COUNT] = {
+            "add", "subtract", "multiply", "divide", "shift", "bitwise", "gcd", "extendedGcd",
+            "modInverse", "power", "powMod", "root", "prime", "toString", "parse",
+            "mulBasecase", "mulKaratsuba", "mulToom3", "mulNtt", "divRem1", "divBasecase",
+            "divDivideAndConquer", "divNewton", "gcdLehmer", "powModSlidingWindow", "powModFixedWindow",
+            "powModLanes", "powModComb", "powModStraus", "powModPippenger", "millerRabin", "strongLucas",
+            "formatDecimalBasecase", "parseDecimalBasecase"
+        };
+        return names[probe];
+    }
+
+    // Time is inclusive and counted once per outermost call, so recursion into the same
+    // variant does not count twice.
+    struct ProbeStats {
+        uint64_t calls;
+        uint64_t limbs;
+        uint64_t nanoseconds;
+    };
+
+    // liveBytes can go negative on a thread that frees what another allocated; peakBytes is
+    // the sum of the per-thread peaks, an upper bound on the process-wide one.
+    struct AllocationStats {
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t allocatedBytes;
+        int64_t liveBytes;
+        int64_t peakBytes;
+    };
+
+    struct Snapshot {
+        ProbeStats probes[PROBE_COUNT];
+        AllocationStats allocation;
+
+        // One line per probe that was hit, then the allocation totals.
+        std::string toText() const {
+            std::string out;
+            char line[160];
+            for (int i = 0; i < PROBE_COUNT; ++i) {
+                const ProbeStats& p = probes[i];
+                if (p.calls == 0) continue;
+                snprintf(line, sizeof(line), "%-22s calls %12llu  limbs %14llu  ms %12.3f\n",
+                    probeName(Probe(i)), (unsigned long long)p.calls, (unsigned long long)p.limbs,
+                    p.nanoseconds / 1e6);
+                out += line;
+            }
+            snprintf(line, sizeof(line), "allocations %llu  frees %llu  bytes %llu  live %lld  peak %lld\n",
+                (unsigned long long)allocation.allocations, (unsigned long long)allocation.frees,
+                (unsigned long long)allocation.allocatedBytes, (long long)allocation.liveBytes,
+                (long long)allocation.peakBytes);
+            return out + line;
+        }
+
+        std::string toJson() const {
+            std::string out = "{\"probes\": {";
+            char item[192];
+            bool first = true;
+            for (int i = 0; i < PROBE_COUNT; ++i) {
+                const ProbeStats& p = probes[i];
+                if (p.calls == 0) continue;
+                snprintf(item, sizeof(item), "%s\"%s\": {\"calls\": %llu, \"limbs\": %llu, \"ns\": %llu}",
+                    first ? "" : ", ", probeName(Probe(i)), (unsigned long long)p.calls,
+                    (unsigned long long)p.limbs, (unsigned long long)p.nanoseconds);
+                out += item;
+                first = false;
+            }
+            snprintf(item, sizeof(item),
+                "}, \"allocation\": {\"allocations\": %llu, \"frees\": %llu, \"bytes\": %llu, \"live\": %lld, \"peak\": %lld}}",
+                (unsigned long long)allocation.allocations, (unsigned long long)allocation.frees,
+                (unsigned long long)allocation.allocatedBytes, (long long)allocation.liveBytes,
+                (long long)allocation.peakBytes);
+            return out + item;
+        }
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Written only by the thread that owns it, read by snapshots from any thread; relaxed
+    // atomics keep that race-free without a locked instruction on the hot path.
+    struct ThreadCounters {
+        std::atomic<uint64_t> calls[PROBE_COUNT];
+        std::atomic<uint64_t> limbs[PROBE_COUNT];
+        std::atomic<uint64_t> nanoseconds[PROBE_COUNT];
+        std::atomic<uint64_t> allocations, frees, allocatedBytes;
+        std::atomic<int64_t> liveBytes, peakBytes;
+        unsigned depth[PROBE_COUNT];
+        Clock::time_point start[PROBE_COUNT];
+
+        ThreadCounters() {
+            clear();
+            for (unsigned& d : depth) d = 0;
+        }
+
+        void clear() {
+            for (int i = 0; i < PROBE_COUNT; ++i) {
+                calls[i].store(0, std::memory_order_relaxed);
+                limbs[i].store(0, std::memory_order_relaxed);
+                nanoseconds[i].store(0, std::memory_order_relaxed);
+            }
+            allocations.store(0, std::memory_order_relaxed);
+            frees.store(0, std::memory_order_relaxed);
+            allocatedBytes.store(0, std::memory_order_relaxed);
+            liveBytes.store(0, std::memory_order_relaxed);
+            peakBytes.store(0, std::memory_order_relaxed);
+        }
+
+        void addTo(Snapshot& s) const {
+            for (int i = 0; i < PROBE_COUNT; ++i) {
+                s.probes[i].calls += calls[i].load(std::memory_order_relaxed);
+                s.probes[i].limbs += limbs[i].load(std::memory_order_relaxed);
+                s.probes[i].nanoseconds += nanoseconds[i].load(std::memory_order_relaxed);
+            }
+            s.allocation.allocations += allocations.load(std::memory_order_relaxed);
+            s.allocation.frees += frees.load(std::memory_order_relaxed);
+            s.allocation.allocatedBytes += allocatedBytes.load(std::memory_order_relaxed);
+            s.allocation.liveBytes += liveBytes.load(std::memory_order_relaxed);
+            s.allocation.peakBytes += peakBytes.load(std::memory_order_relaxed);
+        }
+    };
+
+    template <class T>
+    void bump(std::atomic<T>& counter, T amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    // Counters of every live thread, plus the totals of threads that have exited.
+    struct Registry {
+        std::mutex lock;
+        std::vector<ThreadCounters*> threads;
+        Snapshot retired;
+    };
+
+    inline Registry& registry() {
+        static Registry* state = new Registry();  // never destroyed, threads may outlive main
+        return *state;
+    }
+
+    // Registers on a thread's first probe and folds into the retired totals when it exits.
+    class ThreadSlot {
+    public:
+        ThreadSlot() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.threads.push_back(&counters);
+        }
+
+        ~ThreadSlot() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            counters.addTo(r.retired);
+            for (size_t i = 0; i < r.threads.size(); ++i) {
+                if (r.threads[i] == &counters) {
+                    r.threads.erase(r.threads.begin() + i);
+                    break;
+                }
+            }
+        }
+
+        ThreadCounters counters;
+    };
+
+    inline ThreadCounters& threadCounters() {
+        static thread_local ThreadSlot slot;
+        return slot.counters;
+    }
+
+    class ProbeScope {
+    public:
+        ProbeScope(Probe probe, size_t limbs) : probe(probe), counters(threadCounters()) {
+            bump<uint64_t>(counters.calls[probe], 1);
+            bump<uint64_t>(counters.limbs[probe], limbs);
+            if (counters.depth[probe]++ == 0) counters.start[probe] = Clock::now();
+        }
+
+        ~ProbeScope() {
+            if (--counters.depth[probe] == 0) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - counters.start[probe]);
+                bump<uint64_t>(counters.nanoseconds[probe], uint64_t(elapsed.count()));
+            }
+        }
+
+        ProbeScope(const ProbeScope&) = delete;
+        ProbeScope& operator=(const ProbeScope&) = delete;
+
+    private:
+        Probe probe;
+        ThreadCounters& counters;
+    };
+
+    inline void recordAllocation(size_t bytes) {
+        ThreadCounters& c = threadCounters();
+        bump<uint64_t>(c.allocations, 1);
+        bump<uint64_t>(c.allocatedBytes, bytes);
+        int64_t live = c.liveBytes.load(std::memory_order_relaxed) + int64_t(bytes);
+        c.liveBytes.store(live, std::memory_order_relaxed);
+        if (live > c.peakBytes.load(std::memory_order_relaxed)) c.peakBytes.store(live, std::memory_order_relaxed);
+    }
+
+    inline void recordFree(size_t bytes) {
+        ThreadCounters& c = threadCounters();
+        bump<uint64_t>(c.frees, 1);
+        bump<int64_t>(c.liveBytes, -int64_t(bytes));
+    }
+
+    // std::allocator that records its traffic like BigInt storage does; the limb buffers of the
+    // mpn layer use it when BIGINT_INSTRUMENT is defined.
+    template <class T>
+    struct CountingAllocator {
+        typedef T value_type;
+
+        CountingAllocator() noexcept {
+        }
+
+        template <class U>
+        CountingAllocator(const CountingAllocator<U>&) noexcept {
+        }
+
+        T* allocate(size_t n) {
+            T* p = std::allocator<T>().allocate(n);
+            recordAllocation(n * sizeof(T));
+            return p;
+        }
+
+        void deallocate(T* p, size_t n) noexcept {
+            recordFree(n * sizeof(T));
+            std::allocator<T>().deallocate(p, n);
+        }
+    };
+
+    template <class T, class U>
+    bool operator==(const CountingAllocator<T>&, const CountingAllocator<U>&) { return true; }
+
+    template <class T, class U>
+    bool operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&) { return false; }
+
+    // Totals over every thread that has recorded anything since the last reset.
+    inline Snapshot snapshot() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        Snapshot s = r.retired;
+        for (const ThreadCounters* c : r.threads) c->addTo(s);
+        return s;
+    }
+
+    // The calling thread's counters only; needs no lock.
+    inline Snapshot threadSnapshot() {
+        Snapshot s = Snapshot();
+        threadCounters().addTo(s);
+        return s;
+    }
+
+    // Zeroes every counter. Exact for threads that are not inside an operation; a thread that
+    // is may keep a few of its pre-reset counts.
+    inline void reset() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.retired = Snapshot();
+        for (ThreadCounters* c : r.threads) c->clear();
+    }
+}
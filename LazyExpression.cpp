@@ -0,0 +1,386 @@
+#pragma once
+#include <array>
+#include <stdexcept>
+#include "BigInt.cpp"
+
+// Opt-in expression templates: lazy(a) + lazy(b) * 3 - (lazy(c) << 70) builds a tree of
+// small nodes instead of temporaries. The tree flattens into a linear combination
+//     sum of +-coefficient * value << shift
+// that is evaluated in one pass over the output limbs.
+// Only add, sub, multiply by a signed word and left shift can be chained; the BigInts
+// referenced must outlive the expression, so evaluate it in the statement that builds it.
+
+struct LazyTerm {
+    const BigInt* value;
+    Limb coefficient;
+    bool negative;
+    size_t shift;
+};
+
+// Output limbs produced per block; every term of the expression is applied to a block while it
+// is still in L1, so the operands and the result are each streamed through once.
+#ifndef BIGINT_LAZY_BLOCK
+#define BIGINT_LAZY_BLOCK 256
+#endif
+
+class LazyEvaluator {
+public:
+    template <size_t N>
+    static void evaluate(BigInt& dst, const std::array<LazyTerm, N>& terms) {
+        for (const LazyTerm& term : terms) {
+            if (term.value == &dst) {
+                BigInt result;
+                evaluate(result, terms);
+                dst = std::move(result);
+                return;
+            }
+        }
+
+        std::array<Source, N> sources;
+        size_t count = 0;
+        size_t n = 0;
+        for (const LazyTerm& term : terms) {
+            const LimbVector& limbs = term.value->limbs;
+            if (limbs.empty() || term.coefficient == 0) continue;
+            Source& source = sources[count++];
+            source.limbs = limbs.data();
+            source.size = limbs.size();
+            source.begin = term.shift / mpn::LIMB_BITS;
+            source.bitShift = term.shift % mpn::LIMB_BITS;
+            source.end = source.begin + source.size + (source.bitShift != 0);
+            source.coefficient = term.coefficient;
+            source.subtract = term.negative != !term.value->positive;
+            n = std::max(n, source.end + 1);
+        }
+        n += 1;     // room for the carries of all terms
+
+        // Each block holds its partial sum modulo B^len; the signed 128-bit `carry` is what
+        // spilled past the block and still has to be added to the next one.
+        LimbVector& out = dst.limbs;
+        out.resize(n);
+        Limb carryLo = 0, carryHi = 0;
+        for (size_t from = 0; from < n; from += BIGINT_LAZY_BLOCK) {
+            size_t len = std::min<size_t>(BIGINT_LAZY_BLOCK, n - from);
+            Limb* block = out.data() + from;
+            Limb pendingLo = carryLo, pendingHi = carryHi;
+            carryLo = carryHi = 0;
+
+            // An added term spanning the whole block is written instead of accumulated.
+            size_t first = count;
+            for (size_t t = 0; t < count; ++t) {
+                const Source& source = sources[t];
+                if (!source.subtract && source.begin <= from && source.end >= from + len) {
+                    first = t;
+                    break;
+                }
+            }
+            if (first < count) {
+                const Source& source = sources[first];
+                addCarry(carryLo, carryHi, apply(WRITE, block, source, from - source.begin, from + len - source.begin), false);
+            }
+            else {
+                std::fill(block, block + len, 0);
+            }
+
+            bool negative = (pendingHi >> 63) != 0;
+            Limb pendingTop = negative ? 0 - pendingHi : pendingHi;
+            addCarry(carryLo, carryHi, increment(block, len, pendingLo), false);
+            if (len > 1) {
+                pendingTop = negative ? decrement(block + 1, len - 1, pendingTop) : increment(block + 1, len - 1, pendingTop);
+            }
+            addCarry(carryLo, carryHi, pendingTop, negative);
+
+            for (size_t t = 0; t < count; ++t) {
+                const Source& source = sources[t];
+                size_t lo = std::max(from, source.begin);
+                size_t hi = std::min(from + len, source.end);
+                if (t == first || lo >= hi) continue;
+                Limb* target = block + (lo - from);
+                Limb spill = apply(source.subtract ? SUBTRACT : ADD, target, source, lo - source.begin, hi - source.begin);
+                size_t rest = from + len - hi;
+                spill = source.subtract ? decrement(target + (hi - lo), rest, spill) : increment(target + (hi - lo), rest, spill);
+                addCarry(carryLo, carryHi, spill, source.subtract);
+            }
+        }
+
+        dst.positive = carryLo == 0;
+        if (!dst.positive) mpn::negate(out.data(), n);
+        dst.removeLeadingZeros();
+    }
+
+private:
+    // r[0 .. n) += v, stopping as soon as the carry dies; returns the carry out
+    static Limb increment(Limb* r, size_t n, Limb v) {
+        for (size_t i = 0; i < n && v != 0; ++i) {
+            r[i] += v;
+            v = r[i] < v;
+        }
+        return v;
+    }
+
+    static Limb decrement(Limb* r, size_t n, Limb v) {
+        for (size_t i = 0; i < n && v != 0; ++i) {
+            Limb x = r[i];
+            r[i] = x - v;
+            v = x < v;
+        }
+        return v;
+    }
+
+    // signed 128-bit (lo, hi) += v or -= v
+    static void addCarry(Limb& lo, Limb& hi, Limb v, bool subtract) {
+        if (subtract) {
+            hi -= lo < v;
+            lo -= v;
+        }
+        else {
+            lo += v;
+            hi += lo < v;
+        }
+    }
+
+    // |value| << shift as it lands on output limbs [begin, end)
+    struct Source {
+        const Limb* limbs;
+        size_t size;
+        size_t begin, end;
+        unsigned bitShift;
+        Limb coefficient;
+        bool subtract;
+    };
+
+    enum Mode { WRITE, ADD, SUBTRACT };
+
+    // r[0 .. k-j) = / += / -= limbs [j, k) of (|value| << shift) * coefficient, shifting the
+    // words on the fly; returns the carry or borrow out of the top.
+    template <Mode M, bool Unit>
+    static Limb applyWords(Limb* r, const Source& s, size_t j, size_t k) {
+        unsigned down = mpn::LIMB_BITS - 1 - s.bitShift;   // double shift keeps bitShift == 0 defined
+        Limb prev = j > 0 ? s.limbs[j - 1] : 0;
+        Limb carry = 0;
+        for (size_t m = j; m < k; ++m) {
+            Limb cur = m < s.size ? s.limbs[m] : 0;
+            Limb word = (cur << s.bitShift) | ((prev >> 1) >> down);
+            prev = cur;
+            Limb hi = 0;
+            Limb lo = Unit ? word : mpn::mulWide(word, s.coefficient, hi);
+            lo += carry;
+            hi += lo < carry;
+            Limb& x = r[m - j];
+            if (M == WRITE) {
+                x = lo;
+                carry = hi;
+            }
+            else if (M == ADD) {
+                x += lo;
+                carry = hi + (x < lo);
+            }
+            else {
+                carry = hi + (x < lo);
+                x -= lo;
+            }
+        }
+        return carry;
+    }
+
+    static Limb apply(Mode mode, Limb* r, const Source& s, size_t j, size_t k) {
+        bool unit = s.coefficient == 1;
+        if (s.bitShift == 0) {
+            const Limb* a = s.limbs + j;
+            size_t n = k - j;
+            switch (mode) {
+            case WRITE: return unit ? (std::copy(a, a + n, r), 0) : mpn::mul1(r, a, n, s.coefficient);
+            case ADD: return unit ? mpn::addN(r, r, a, n) : mpn::addMul1(r, a, n, s.coefficient);
+            default: return unit ? mpn::subN(r, r, a, n) : mpn::subMul1(r, a, n, s.coefficient);
+            }
+        }
+        switch (mode) {
+        case WRITE: return unit ? applyWords<WRITE, true>(r, s, j, k) : applyWords<WRITE, false>(r, s, j, k);
+        case ADD: return unit ? applyWords<ADD, true>(r, s, j, k) : applyWords<ADD, false>(r, s, j, k);
+        default: return unit ? applyWords<SUBTRACT, true>(r, s, j, k) : applyWords<SUBTRACT, false>(r, s, j, k);
+        }
+    }
+};
+
+template <class Derived>
+class LazyExpression {
+public:
+    const Derived& self() const {
+        return static_cast<const Derived&>(*this);
+    }
+
+    void evaluateInto(BigInt& dst) const {
+        std::array<LazyTerm, Derived::TERMS> terms;
+        self().collect(terms.data(), 1, false, 0);
+        LazyEvaluator::evaluate(dst, terms);
+    }
+
+    BigInt evaluate() const {
+        BigInt result;
+        evaluateInto(result);
+        return result;
+    }
+
+    operator BigInt() const {
+        return evaluate();
+    }
+};
+
+class LazyValue : public LazyExpression<LazyValue> {
+public:
+    static const size_t TERMS = 1;
+
+    explicit LazyValue(const BigInt& value) : value(value) {
+    }
+
+    void collect(LazyTerm* out, Limb coefficient, bool negative, size_t shift) const {
+        out->value = &value;
+        out->coefficient = coefficient;
+        out->negative = negative;
+        out->shift = shift;
+    }
+
+private:
+    const BigInt& value;
+};
+
+template <class L, class R>
+class LazySum : public LazyExpression<LazySum<L, R>> {
+public:
+    static const size_t TERMS = L::TERMS + R::TERMS;
+
+    LazySum(const L& left, const R& right, bool subtract) : left(left), right(right), subtract(subtract) {
+    }
+
+    void collect(LazyTerm* out, Limb coefficient, bool negative, size_t shift) const {
+        left.collect(out, coefficient, negative, shift);
+        right.collect(out + L::TERMS, coefficient, negative != subtract, shift);
+    }
+
+private:
+    L left;
+    R right;
+    bool subtract;
+};
+
+template <class E>
+class LazyScaled : public LazyExpression<LazyScaled<E>> {
+public:
+    static const size_t TERMS = E::TERMS;
+
+    LazyScaled(const E& inner, long long factor) : inner(inner), negated(factor < 0) {
+        this->factor = factor < 0 ? 0 - (unsigned long long)factor : factor;
+    }
+
+    // Powers of two move into the shift, so only the odd parts have to share one limb.
+    void collect(LazyTerm* out, Limb coefficient, bool negative, size_t shift) const {
+        if (factor == 0 || coefficient == 0) {
+            inner.collect(out, 0, negative, shift);
+            return;
+        }
+        int a = mpn::countTrailingZeros(coefficient);
+        int b = mpn::countTrailingZeros(factor);
+        Limb hi;
+        Limb product = mpn::mulWide(coefficient >> a, factor >> b, hi);
+        if (hi != 0) {
+            throw std::overflow_error("Lazy coefficient does not fit in a limb");
+        }
+        inner.collect(out, product, negative != negated, shift + a + b);
+    }
+
+private:
+    E inner;
+    Limb factor;
+    bool negated;
+};
+
+template <class E>
+class LazyShifted : public LazyExpression<LazyShifted<E>> {
+public:
+    static const size_t TERMS = E::TERMS;
+
+    LazyShifted(const E& inner, size_t bits) : inner(inner), bits(bits) {
+    }
+
+    void collect(LazyTerm* out, Limb coefficient, bool negative, size_t shift) const {
+        inner.collect(out, coefficient, negative, shift + bits);
+    }
+
+private:
+    E inner;
+    size_t bits;
+};
+
+inline LazyValue lazy(const BigInt& value) {
+    return LazyValue(value);
+}
+
+template <class L, class R>
+LazySum<L, R> operator+(const LazyExpression<L>& left, const LazyExpression<R>& right) {
+    return LazySum<L, R>(left.self(), right.self(), false);
+}
+
+template <class L>
+LazySum<L, LazyValue> operator+(const LazyExpression<L>& left, const BigInt& right) {
+    return LazySum<L, LazyValue>(left.self(), LazyValue(right), false);
+}
+
+template <class R>
+LazySum<LazyValue, R> operator+(const BigInt& left, const LazyExpression<R>& right) {
+    return LazySum<LazyValue, R>(LazyValue(left), right.self(), false);
+}
+
+// Temporaries live to the end of the full expression; these overloads keep them from
+// being matched by BigInt's own rvalue operators through the conversion to BigInt.
+template <class L>
+LazySum<L, LazyValue> operator+(const LazyExpression<L>& left, BigInt&& right) {
+    return LazySum<L, LazyValue>(left.self(), LazyValue(right), false);
+}
+
+template <class R>
+LazySum<LazyValue, R> operator+(BigInt&& left, const LazyExpression<R>& right) {
+    return LazySum<LazyValue, R>(LazyValue(left), right.self(), false);
+}
+
+template <class L, class R>
+LazySum<L, R> operator-(const LazyExpression<L>& left, const LazyExpression<R>& right) {
+    return LazySum<L, R>(left.self(), right.self(), true);
+}
+
+template <class L>
+LazySum<L, LazyValue> operator-(const LazyExpression<L>& left, const BigInt& right) {
+    return LazySum<L, LazyValue>(left.self(), LazyValue(right), true);
+}
+
+template <class R>
+LazySum<LazyValue, R> operator-(const BigInt& left, const LazyExpression<R>& right) {
+    return LazySum<LazyValue, R>(LazyValue(left), right.self(), true);
+}
+
+template <class L>
+LazySum<L, LazyValue> operator-(const LazyExpression<L>& left, BigInt&& right) {
+    return LazySum<L, LazyValue>(left.self(), LazyValue(right), true);
+}
+
+template <class R>
+LazySum<LazyValue, R> operator-(BigInt&& left, const LazyExpression<R>& right) {
+    return LazySum<LazyValue, R>(LazyValue(left), right.self(), true);
+}
+
+template <class E>
+LazyScaled<E> operator*(const LazyExpression<E>& e, long long factor) {
+    return LazyScaled<E>(e.self(), factor);
+}
+
+template <class E>
+LazyScaled<E> operator*(long long factor, const LazyExpression<E>& e) {
+    return LazyScaled<E>(e.self(), factor);
+}
+
+template <class E>
+LazyShifted<E> operator<<(const LazyExpression<E>& e, int shift) {
+    if (shift < 0) {
+        throw std::runtime_error("Negative shift");
+    }
+    return LazyShifted<E>(e.self(), size_t(shift));
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include "Limbs.cpp"
+
+// Growable limb array with room for INLINE_LIMBS limbs inside the object, so values up to
+// 128 bits never allocate. Offers the subset of std::vector<Limb> that BigInt uses.
+class LimbVector {
+public:
+    static const size_t INLINE_LIMBS = 2;
+
+    LimbVector() : ptr(inlineLimbs), count(0), cap(INLINE_LIMBS) {
+    }
+
+    LimbVector(size_t n, Limb value) : LimbVector() {
+        assign(n, value);
+    }
+
+    LimbVector(const Limb* first, const Limb* last) : LimbVector() {
+        assign(first, last);
+    }
+
+    LimbVector(const LimbVector& other) : LimbVector() {
+        assign(other.begin(), other.end());
+    }
+
+    LimbVector(LimbVector&& other) noexcept : LimbVector() {
+        swap(other);
+    }
+
+    ~LimbVector() {
+        if (ptr != inlineLimbs) release();
+    }
+
+    LimbVector& operator=(const LimbVector& other) {
+        if (this != &other) assign(other.begin(), other.end());
+        return *this;
+    }
+
+    LimbVector& operator=(LimbVector&& other) noexcept {
+        if (this != &other) {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    // Heap buffers trade pointers; inline contents are copied.
+    void swap(LimbVector& other) noexcept {
+        if (ptr != inlineLimbs && other.ptr != other.inlineLimbs) {
+            std::swap(ptr, other.ptr);
+            std::swap(cap, other.cap);
+        }
+        else if (ptr == inlineLimbs && other.ptr == other.inlineLimbs) {
+            std::swap(inlineLimbs, other.inlineLimbs);
+        }
+        else {
+            LimbVector& heap = ptr != inlineLimbs ? *this : other;
+            LimbVector& small = ptr != inlineLimbs ? other : *this;
+            std::copy(small.inlineLimbs, small.inlineLimbs + small.count, heap.inlineLimbs);
+            small.ptr = heap.ptr;
+            small.cap = heap.cap;
+            heap.ptr = heap.inlineLimbs;
+            heap.cap = INLINE_LIMBS;
+        }
+        std::swap(count, other.count);
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return count == 0; }
+    Limb* data() { return ptr; }
+    const Limb* data() const { return ptr; }
+    Limb* begin() { return ptr; }
+    Limb* end() { return ptr + count; }
+    const Limb* begin() const { return ptr; }
+    const Limb* end() const { return ptr + count; }
+    Limb& operator[](size_t i) { return ptr[i]; }
+    const Limb& operator[](size_t i) const { return ptr[i]; }
+    Limb& back() { return ptr[count - 1]; }
+    const Limb& back() const { return ptr[count - 1]; }
+
+    void clear() { count = 0; }
+    void pop_back() { --count; }
+
+    void push_back(Limb value) {
+        if (count == cap) reserve(2 * cap);
+        ptr[count++] = value;
+    }
+
+    void reserve(size_t n) {
+        if (n <= cap) return;
+        Limb* grown = new Limb[n];
+        BIGINT_RECORD_ALLOCATION(n * sizeof(Limb));
+        std::memcpy(grown, ptr, count * sizeof(Limb));
+        if (ptr != inlineLimbs) release();
+        ptr = grown;
+        cap = n;
+    }
+
+    // New limbs are set to value, like std::vector::resize.
+    void resize(size_t n, Limb value = 0) {
+        if (n > cap) reserve(std::max(n, 2 * cap));
+        if (n > count) std::fill(ptr + count, ptr + n, value);
+        count = n;
+    }
+
+    void assign(size_t n, Limb value) {
+        count = 0;
+        resize(n, value);
+    }
+
+    void assign(const Limb* first, const Limb* last) {
+        size_t n = size_t(last - first);
+        if (n > cap) {
+            count = 0;
+            reserve(n);
+        }
+        std::memmove(ptr, first, n * sizeof(Limb));
+        count = n;
+    }
+
+    bool operator==(const LimbVector& other) const {
+        return count == other.count && std::equal(begin(), end(), other.begin());
+    }
+
+    bool operator!=(const LimbVector& other) const {
+        return !(*this == other);
+    }
+
+private:
+    Limb* ptr;
+    size_t count;
+    size_t cap;
+    Limb inlineLimbs[INLINE_LIMBS] = {};
+
+    void release() {
+        BIGINT_RECORD_FREE(cap * sizeof(Limb));
+        delete[] ptr;
+    }
+};
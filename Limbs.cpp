@@ -0,0 +1,293 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "Instrumentation.cpp"
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+// Magnitudes are stored as little-endian arrays of 64-bit limbs.
+typedef std::uint64_t Limb;
+
+// Heap limbs of the mpn layer: scratch, residues, tables. Plain std::vector unless
+// BIGINT_INSTRUMENT is defined, in which case their allocations are counted too.
+#ifdef BIGINT_INSTRUMENT
+typedef std::vector<Limb, instrumentation::CountingAllocator<Limb>> LimbBuffer;
+#else
+typedef std::vector<Limb> LimbBuffer;
+#endif
+
+// Shorter operands skip the dispatched kernels and run the inlined portable loops.
+#ifndef BIGINT_KERNEL_THRESHOLD
+#define BIGINT_KERNEL_THRESHOLD 8
+#endif
+
+namespace mpn {
+
+    const int LIMB_BITS = 64;
+
+    // lo word of a * b, hi word goes to `hi`
+    inline Limb mulWide(Limb a, Limb b, Limb& hi) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 p = (unsigned __int128)a * b;
+        hi = (Limb)(p >> 64);
+        return (Limb)p;
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return _umul128(a, b, &hi);
+#else
+        Limb al = a & 0xffffffffu, ah = a >> 32;
+        Limb bl = b & 0xffffffffu, bh = b >> 32;
+        Limb ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+        Limb mid = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+        hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+        return (mid << 32) | (ll & 0xffffffffu);
+#endif
+    }
+
+    // (hi:lo) / d, requires hi < d
+    inline Limb divWide(Limb hi, Limb lo, Limb d, Limb& rem) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 n = ((unsigned __int128)hi << 64) | lo;
+        rem = (Limb)(n % d);
+        return (Limb)(n / d);
+#elif defined(_MSC_VER) && defined(_M_X64) && _MSC_VER >= 1920
+        return _udiv128(hi, lo, d, &rem);
+#else
+        Limb q = 0;
+        for (int i = 0; i < 64; ++i) {
+            Limb top = hi >> 63;
+            hi = (hi << 1) | (lo >> 63);
+            lo <<= 1;
+            q <<= 1;
+            if (top || hi >= d) {
+                hi -= d;
+                q |= 1;
+            }
+        }
+        rem = hi;
+        return q;
+#endif
+    }
+
+    inline int countLeadingZeros(Limb x) {
+        if (x == 0) return 64;
+#if defined(__GNUC__)
+        return __builtin_clzll(x);
+#else
+        int n = 0;
+        while (!(x & (Limb(1) << 63))) {
+            x <<= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    inline int countTrailingZeros(Limb x) {
+        if (x == 0) return 64;
+#if defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while (!(x & 1)) {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    inline int cmp(const Limb* a, const Limb* b, size_t n) {
+        while (n-- > 0) {
+            if (a[n] != b[n]) return a[n] > b[n] ? 1 : -1;
+        }
+        return 0;
+    }
+
+    // Portable kernels; the entry points below hand longer operands to the ones CpuKernels.cpp
+    // picks for this CPU.
+    namespace generic {
+
+        // r = a + b over n limbs, returns carry
+        inline Limb addN(Limb* r, const Limb* a, const Limb* b, size_t n) {
+            Limb carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Limb s = a[i] + carry;
+                carry = s < carry;
+                r[i] = s + b[i];
+                carry += r[i] < s;
+            }
+            return carry;
+        }
+
+        // r = a - b over n limbs, returns borrow
+        inline Limb subN(Limb* r, const Limb* a, const Limb* b, size_t n) {
+            Limb borrow = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Limb d = a[i] - b[i];
+                Limb b1 = a[i] < b[i];
+                r[i] = d - borrow;
+                borrow = b1 | (d < borrow);
+            }
+            return borrow;
+        }
+
+        // r = a * b, returns the carry limb
+        inline Limb mul1(Limb* r, const Limb* a, size_t n, Limb b) {
+            Limb carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Limb hi;
+                Limb lo = mulWide(a[i], b, hi);
+                lo += carry;
+                carry = hi + (lo < carry);
+                r[i] = lo;
+            }
+            return carry;
+        }
+
+        // r += a * b, returns the carry limb
+        inline Limb addMul1(Limb* r, const Limb* a, size_t n, Limb b) {
+            Limb carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Limb hi;
+                Limb lo = mulWide(a[i], b, hi);
+                lo += carry;
+                hi += lo < carry;
+                r[i] += lo;
+                carry = hi + (r[i] < lo);
+            }
+            return carry;
+        }
+
+        // r -= a * b, returns the borrow limb
+        inline Limb subMul1(Limb* r, const Limb* a, size_t n, Limb b) {
+            Limb borrow = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Limb hi;
+                Limb lo = mulWide(a[i], b, hi);
+                lo += borrow;
+                hi += lo < borrow;
+                Limb x = r[i];
+                r[i] = x - lo;
+                borrow = hi + (x < lo);
+            }
+            return borrow;
+        }
+
+        // r = a << cnt, 0 < cnt < 64, returns bits shifted out
+        inline Limb lshift(Limb* r, const Limb* a, size_t n, unsigned cnt) {
+            Limb out = a[n - 1] >> (64 - cnt);
+            for (size_t i = n - 1; i > 0; --i) {
+                r[i] = (a[i] << cnt) | (a[i - 1] >> (64 - cnt));
+            }
+            r[0] = a[0] << cnt;
+            return out;
+        }
+
+        // r = a >> cnt, 0 < cnt < 64, returns bits shifted out (in the high end)
+        inline Limb rshift(Limb* r, const Limb* a, size_t n, unsigned cnt) {
+            Limb out = a[0] << (64 - cnt);
+            for (size_t i = 0; i + 1 < n; ++i) {
+                r[i] = (a[i] >> cnt) | (a[i + 1] << (64 - cnt));
+            }
+            r[n - 1] = a[n - 1] >> cnt;
+            return out;
+        }
+    }
+
+    struct KernelTable {
+        Limb (*addN)(Limb*, const Limb*, const Limb*, size_t);
+        Limb (*subN)(Limb*, const Limb*, const Limb*, size_t);
+        Limb (*mul1)(Limb*, const Limb*, size_t, Limb);
+        Limb (*addMul1)(Limb*, const Limb*, size_t, Limb);
+        Limb (*subMul1)(Limb*, const Limb*, size_t, Limb);
+        Limb (*lshift)(Limb*, const Limb*, size_t, unsigned);
+        Limb (*rshift)(Limb*, const Limb*, size_t, unsigned);
+        const char* name;
+    };
+
+    inline const KernelTable& kernels();
+
+    // r = a + b over n limbs, returns carry
+    inline Limb addN(Limb* r, const Limb* a, const Limb* b, size_t n) {
+        return n < BIGINT_KERNEL_THRESHOLD ? generic::addN(r, a, b, n) : kernels().addN(r, a, b, n);
+    }
+
+    // r = a + b, an >= bn, returns carry
+    inline Limb add(Limb* r, const Limb* a, size_t an, const Limb* b, size_t bn) {
+        Limb carry = addN(r, a, b, bn);
+        for (size_t i = bn; i < an; ++i) {
+            r[i] = a[i] + carry;
+            carry = r[i] < carry;
+        }
+        return carry;
+    }
+
+    // r = a - b over n limbs, returns borrow
+    inline Limb subN(Limb* r, const Limb* a, const Limb* b, size_t n) {
+        return n < BIGINT_KERNEL_THRESHOLD ? generic::subN(r, a, b, n) : kernels().subN(r, a, b, n);
+    }
+
+    // r = a - b, an >= bn, returns borrow
+    inline Limb sub(Limb* r, const Limb* a, size_t an, const Limb* b, size_t bn) {
+        Limb borrow = subN(r, a, b, bn);
+        for (size_t i = bn; i < an; ++i) {
+            Limb x = a[i];
+            r[i] = x - borrow;
+            borrow = x < borrow;
+        }
+        return borrow;
+    }
+
+    // r = a * b, returns the carry limb
+    inline Limb mul1(Limb* r, const Limb* a, size_t n, Limb b) {
+        return n < BIGINT_KERNEL_THRESHOLD ? generic::mul1(r, a, n, b) : kernels().mul1(r, a, n, b);
+    }
+
+    // r += a * b, returns the carry limb
+    inline Limb addMul1(Limb* r, const Limb* a, size_t n, Limb b) {
+        return n < BIGINT_KERNEL_THRESHOLD ? generic::addMul1(r, a, n, b) : kernels().addMul1(r, a, n, b);
+    }
+
+    // r -= a * b, returns the borrow limb
+    inline Limb subMul1(Limb* r, const Limb* a, size_t n, Limb b) {
+        return n < BIGINT_KERNEL_THRESHOLD ? generic::subMul1(r, a, n, b) : kernels().subMul1(r, a, n, b);
+    }
+
+    // r = a << cnt, 0 < cnt < 64, returns bits shifted out; r >= a may overlap
+    inline Limb lshift(Limb* r, const Limb* a, size_t n, unsigned cnt) {
+        return n < BIGINT_KERNEL_THRESHOLD ? generic::lshift(r, a, n, cnt) : kernels().lshift(r, a, n, cnt);
+    }
+
+    // r = a >> cnt, 0 < cnt < 64, returns bits shifted out (in the high end); r <= a may overlap
+    inline Limb rshift(Limb* r, const Limb* a, size_t n, unsigned cnt) {
+        return n < BIGINT_KERNEL_THRESHOLD ? generic::rshift(r, a, n, cnt) : kernels().rshift(r, a, n, cnt);
+    }
+
+    // q = a / d, returns a % d
+    inline Limb divRem1(Limb* q, const Limb* a, size_t n, Limb d) {
+        BIGINT_PROBE(DivRem1, n);
+        Limb rem = 0;
+        for (size_t i = n; i-- > 0;) {
+            q[i] = divWide(rem, a[i], d, rem);
+        }
+        return rem;
+    }
+
+    // r[0 .. an+bn) = a * b, r must not overlap the inputs
+    inline void mulBasecase(Limb* r, const Limb* a, size_t an, const Limb* b, size_t bn) {
+        BIGINT_PROBE(MulBasecase, an + bn);
+        r[an] = mul1(r, a, an, b[0]);
+        for (size_t j = 1; j < bn; ++j) {
+            r[an + j] = addMul1(r + j, a, an, b[j]);
+        }
+    }
+
+    inline size_t normalizedSize(const Limb* a, size_t n) {
+        while (n > 0 && a[n - 1] == 0) --n;
+        return n;
+    }
+}
+
+#include "CpuKernels.cpp"
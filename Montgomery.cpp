@@ -0,0 +1,114 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "Division.cpp"
+
+// Montgomery arithmetic modulo an odd n-limb modulus N with R = B^n.
+// Built once per modulus; every product afterwards is division-free and works in
+// caller-provided scratch of scratchSize() limbs.
+class MontgomeryContext {
+public:
+    MontgomeryContext(const Limb* modulus, size_t n) : mod(modulus, modulus + mpn::normalizedSize(modulus, n)) {
+        if (mod.empty() || (mod[0] & 1) == 0) {
+            throw std::runtime_error("Montgomery modulus must be odd");
+        }
+        size_t size = mod.size();
+        Limb inv = mod[0];                      // Newton iteration for N^-1 mod 2^64
+        for (int i = 0; i < 6; ++i) inv *= 2 - mod[0] * inv;
+        nPrime = ~inv + 1;
+
+        // R mod N and R^2 mod N, the only divisions this class ever does
+        LimbBuffer power(2 * size + 1, 0);
+        LimbBuffer q(size + 2);
+        power[size] = 1;
+        rModN.resize(size);
+        mpn::divRem(q.data(), rModN.data(), power.data(), size + 1, mod.data(), size);
+        power[size] = 0;
+        power[2 * size] = 1;
+        r2ModN.resize(size);
+        mpn::divRem(q.data(), r2ModN.data(), power.data(), 2 * size + 1, mod.data(), size);
+    }
+
+    // from any contiguous limb container: LimbBuffer, LimbVector, BigInt::magnitude()
+    template <class Limbs>
+    explicit MontgomeryContext(const Limbs& modulus) : MontgomeryContext(modulus.data(), modulus.size()) {
+    }
+
+    size_t size() const { return mod.size(); }
+    size_t scratchSize() const { return mod.size() + 2; }
+    const Limb* modulus() const { return mod.data(); }
+    Limb n0() const { return nPrime; }  // -N^-1 mod B
+    const Limb* rSquared() const { return r2ModN.data(); }
+    const Limb* one() const { return rModN.data(); }  // 1 in Montgomery form
+
+    // r = a * b * R^-1 mod N by CIOS; a, b < N, r may alias either input.
+    void mul(Limb* r, const Limb* a, const Limb* b, Limb* scratch) const {
+        size_t n = mod.size();
+        Limb* t = scratch;
+        std::fill(t, t + n + 2, 0);
+        for (size_t i = 0; i < n; ++i) {
+            Limb carry = mpn::addMul1(t, a, n, b[i]);
+            t[n] += carry;
+            t[n + 1] = t[n] < carry;
+            reduceStep(t);
+        }
+        finish(r, t);
+    }
+
+    void sqr(Limb* r, const Limb* a, Limb* scratch) const {
+        mul(r, a, a, scratch);
+    }
+
+    // r = a * R mod N for a < N
+    void toMontgomery(Limb* r, const Limb* a, Limb* scratch) const {
+        mul(r, a, r2ModN.data(), scratch);
+    }
+
+    // r = a * R^-1 mod N for a < N
+    void fromMontgomery(Limb* r, const Limb* a, Limb* scratch) const {
+        size_t n = mod.size();
+        Limb* t = scratch;
+        std::copy(a, a + n, t);
+        t[n] = 0;
+        t[n + 1] = 0;
+        for (size_t i = 0; i < n; ++i) reduceStep(t);
+        finish(r, t);
+    }
+
+private:
+    LimbBuffer mod;
+    LimbBuffer rModN;
+    LimbBuffer r2ModN;
+    Limb nPrime;
+
+    // t = (t + m * N) / B with m chosen so the low word cancels
+    void reduceStep(Limb* t) const {
+        size_t n = mod.size();
+        Limb m = t[0] * nPrime;
+        Limb hi;
+        Limb lo = mpn::mulWide(m, mod[0], hi);
+        Limb carry = hi + (t[0] + lo < lo);
+        for (size_t j = 1; j < n; ++j) {
+            lo = mpn::mulWide(m, mod[j], hi);
+            lo += carry;
+            hi += lo < carry;
+            lo += t[j];
+            hi += lo < t[j];
+            t[j - 1] = lo;
+            carry = hi;
+        }
+        t[n - 1] = t[n] + carry;
+        t[n] = t[n + 1] + (t[n - 1] < carry);
+        t[n + 1] = 0;
+    }
+
+    // t < 2N, one subtraction brings it below N; the choice is made without branching
+    // so the constant-time exponentiation stays constant-time.
+    void finish(Limb* r, const Limb* t) const {
+        size_t n = mod.size();
+        Limb borrow = mpn::subN(r, t, mod.data(), n);
+        Limb keep = 0 - (borrow & ~t[n] & 1);
+        for (size_t i = 0; i < n; ++i) r[i] = (r[i] & ~keep) | (t[i] & keep);
+    }
+};
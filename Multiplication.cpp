@@ -0,0 +1,272 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "Limbs.cpp"
+#include "NTT.cpp"
+
+// Crossovers in limbs of the shorter operand, override with -D at build time.
+#ifndef BIGINT_KARATSUBA_THRESHOLD
+#define BIGINT_KARATSUBA_THRESHOLD 32
+#endif
+#ifndef BIGINT_TOOM3_THRESHOLD
+#define BIGINT_TOOM3_THRESHOLD 128
+#endif
+
+namespace mpn {
+
+    inline bool useKaratsuba(size_t n) {
+        return n >= BIGINT_KARATSUBA_THRESHOLD && n >= 4;
+    }
+
+    inline bool useToom3(size_t n) {
+        return n >= BIGINT_TOOM3_THRESHOLD && n >= 9;
+    }
+
+    inline bool useNtt(size_t n) {
+        return n >= BIGINT_NTT_THRESHOLD;
+    }
+
+    // Scratch limbs needed by mulBalanced for n-limb operands.
+    inline size_t mulBalancedScratch(size_t n) {
+        if (!useKaratsuba(n) || useNtt(n)) return 0;
+        if (!useToom3(n)) {
+            size_t h = (n + 1) / 2;
+            return 6 * h + 1 + mulBalancedScratch(h);
+        }
+        size_t k = (n + 2) / 3;
+        return 3 * (2 * k + 3) + 8 * (k + 1) + mulBalancedScratch(k + 1);
+    }
+
+    // r[0 .. n) = |a - b| where a has n limbs and b has bn <= n; returns true if b > a.
+    inline bool absDiff(Limb* r, const Limb* a, size_t n, const Limb* b, size_t bn) {
+        int c = normalizedSize(a + bn, n - bn) > 0 ? 1 : cmp(a, b, bn);
+        if (c >= 0) {
+            sub(r, a, n, b, bn);
+            return false;
+        }
+        subN(r, b, a, bn);
+        std::fill(r + bn, r + n, 0);
+        return true;
+    }
+
+    // Two's complement helpers over a fixed width of n limbs.
+    inline void negate(Limb* a, size_t n) {
+        Limb carry = 1;
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = ~a[i] + carry;
+            carry = carry && a[i] == 0;
+        }
+    }
+
+    inline void shiftRightSigned1(Limb* a, size_t n) {
+        Limb sign = a[n - 1] >> 63;
+        rshift(a, a, n, 1);
+        a[n - 1] |= sign << 63;
+    }
+
+    // a / 3 for a known to be a multiple of 3, exact modulo B^n
+    inline void divExactBy3(Limb* r, const Limb* a, size_t n) {
+        const Limb inv3 = 0xAAAAAAAAAAAAAAABULL;
+        Limb carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            Limb x = a[i];
+            Limb s = x - carry;
+            carry = x < carry;
+            Limb q = s * inv3;
+            r[i] = q;
+            carry += (q > 0x5555555555555555ULL) + (q > 0xAAAAAAAAAAAAAAAAULL);
+        }
+    }
+
+    // r[off ..) += a, where the sum is known to fit in r[0 .. rn)
+    inline void addShifted(Limb* r, size_t rn, size_t off, const Limb* a, size_t an) {
+        an = normalizedSize(a, std::min(an, rn - off));
+        if (an > 0) add(r + off, r + off, rn - off, a, an);
+    }
+
+    inline void mulBalanced(Limb* r, const Limb* a, const Limb* b, size_t n, Limb* scratch);
+
+    // Subtractive Karatsuba: a0*b1 + a1*b0 = a0*b0 + a1*b1 - (a0 - a1)(b0 - b1).
+    inline void mulKaratsuba(Limb* r, const Limb* a, const Limb* b, size_t n, Limb* scratch) {
+        BIGINT_PROBE(MulKaratsuba, 2 * n);
+        size_t h = (n + 1) / 2;
+        size_t hs = n - h;
+        const Limb* a0 = a;
+        const Limb* a1 = a + h;
+        const Limb* b0 = b;
+        const Limb* b1 = b + h;
+
+        Limb* da = scratch;
+        Limb* db = da + h;
+        Limb* z1 = db + h;
+        Limb* t = z1 + 2 * h;
+        Limb* next = t + 2 * h + 1;
+
+        bool negA = absDiff(da, a0, h, a1, hs);
+        bool negB = absDiff(db, b0, h, b1, hs);
+        if (ThreadPool* pool = parallelPool(n)) {
+            // the three products are independent; each task gets its own scratch
+            LimbBuffer more(2 * mulBalancedScratch(h));
+            Limb* nextHigh = more.data();
+            Limb* nextMiddle = nextHigh + mulBalancedScratch(h);
+            TaskGroup group(pool);
+            group.run([=] { mulBalanced(r + 2 * h, a1, b1, hs, nextHigh); });
+            group.run([=] { mulBalanced(z1, da, db, h, nextMiddle); });
+            mulBalanced(r, a0, b0, h, next);
+            group.wait();
+        }
+        else {
+            mulBalanced(r, a0, b0, h, next);
+            mulBalanced(r + 2 * h, a1, b1, hs, next);
+            mulBalanced(z1, da, db, h, next);
+        }
+
+        t[2 * h] = add(t, r, 2 * h, r + 2 * h, 2 * hs);
+        if (negA == negB) sub(t, t, 2 * h + 1, z1, 2 * h);
+        else add(t, t, 2 * h + 1, z1, 2 * h);
+        addShifted(r, 2 * n, h, t, 2 * h + 1);
+    }
+
+    // p(1) = x0 + x1 + x2, p(-1) = x0 - x1 + x2, p(-2) = x0 - 2 x1 + 4 x2, each k + 1 limbs.
+    // The signed values come back as magnitude plus a negative flag.
+    inline void toom3Evaluate(Limb* p1, Limb* pm1, Limb* pm2, bool& negM1, bool& negM2,
+                              const Limb* x0, const Limb* x1, const Limb* x2, size_t k, size_t t,
+                              Limb* tmp1, Limb* tmp2) {
+        tmp1[k] = add(tmp1, x0, k, x2, t);
+        p1[k] = tmp1[k] + add(p1, tmp1, k, x1, k);
+        negM1 = absDiff(pm1, tmp1, k + 1, x1, k);
+
+        std::fill(tmp2, tmp2 + k + 1, 0);
+        tmp2[t] = lshift(tmp2, x2, t, 2);
+        std::copy(x0, x0 + k, tmp1);
+        tmp1[k] = 0;
+        addN(tmp1, tmp1, tmp2, k + 1);
+        tmp2[k] = lshift(tmp2, x1, k, 1);
+        negM2 = absDiff(pm2, tmp1, k + 1, tmp2, k + 1);
+    }
+
+    // Toom-Cook 3 with evaluation points 0, 1, -1, -2, inf and Bodrato's interpolation sequence.
+    inline void mulToom3(Limb* r, const Limb* a, const Limb* b, size_t n, Limb* scratch) {
+        BIGINT_PROBE(MulToom3, 2 * n);
+        size_t k = (n + 2) / 3;
+        size_t t = n - 2 * k;
+        size_t w = 2 * k + 3;
+        const Limb* a0 = a;
+        const Limb* a1 = a + k;
+        const Limb* a2 = a + 2 * k;
+        const Limb* b0 = b;
+        const Limb* b1 = b + k;
+        const Limb* b2 = b + 2 * k;
+
+        Limb* r1 = scratch;
+        Limb* rm1 = r1 + w;
+        Limb* rm2 = rm1 + w;
+        Limb* p1 = rm2 + w;
+        Limb* pm1 = p1 + (k + 1);
+        Limb* pm2 = pm1 + (k + 1);
+        Limb* q1 = pm2 + (k + 1);
+        Limb* qm1 = q1 + (k + 1);
+        Limb* qm2 = qm1 + (k + 1);
+        Limb* tmp1 = qm2 + (k + 1);
+        Limb* tmp2 = tmp1 + (k + 1);
+        Limb* next = tmp2 + (k + 1);
+
+        bool negPm1, negPm2, negQm1, negQm2;
+        toom3Evaluate(p1, pm1, pm2, negPm1, negPm2, a0, a1, a2, k, t, tmp1, tmp2);
+        toom3Evaluate(q1, qm1, qm2, negQm1, negQm2, b0, b1, b2, k, t, tmp1, tmp2);
+
+        if (ThreadPool* pool = parallelPool(n)) {
+            size_t each = mulBalancedScratch(k + 1);
+            LimbBuffer more(4 * each);
+            Limb* s = more.data();
+            TaskGroup group(pool);
+            group.run([=] { mulBalanced(r1, p1, q1, k + 1, s); });
+            group.run([=] { mulBalanced(rm1, pm1, qm1, k + 1, s + each); });
+            group.run([=] { mulBalanced(rm2, pm2, qm2, k + 1, s + 2 * each); });
+            group.run([=] { mulBalanced(r + 4 * k, a2, b2, t, s + 3 * each); });
+            mulBalanced(r, a0, b0, k, next);
+            group.wait();
+        }
+        else {
+            mulBalanced(r1, p1, q1, k + 1, next);
+            mulBalanced(rm1, pm1, qm1, k + 1, next);
+            mulBalanced(rm2, pm2, qm2, k + 1, next);
+            mulBalanced(r, a0, b0, k, next);
+            mulBalanced(r + 4 * k, a2, b2, t, next);
+        }
+        std::fill(r1 + 2 * k + 2, r1 + w, 0);
+        std::fill(rm1 + 2 * k + 2, rm1 + w, 0);
+        std::fill(rm2 + 2 * k + 2, rm2 + w, 0);
+        if (negPm1 != negQm1) negate(rm1, w);
+        if (negPm2 != negQm2) negate(rm2, w);
+
+        std::fill(r + 2 * k, r + 4 * k, 0);
+        const Limb* c0 = r;
+        const Limb* c4 = r + 4 * k;
+
+        subN(rm2, rm2, r1, w);                  // (r(-2) - r(1)) / 3
+        divExactBy3(rm2, rm2, w);
+        subN(r1, r1, rm1, w);                   // (r(1) - r(-1)) / 2
+        shiftRightSigned1(r1, w);
+        sub(rm1, rm1, w, c0, 2 * k);            // r(-1) - r(0)
+        subN(rm2, rm1, rm2, w);                 // c3 = (rm1 - rm2) / 2 + 2 r(inf)
+        shiftRightSigned1(rm2, w);
+        add(rm2, rm2, w, c4, 2 * t);
+        add(rm2, rm2, w, c4, 2 * t);
+        addN(rm1, rm1, r1, w);                  // c2 = rm1 + r1 - r(inf)
+        sub(rm1, rm1, w, c4, 2 * t);
+        subN(r1, r1, rm2, w);                   // c1 = r1 - c3
+
+        addShifted(r, 2 * n, k, r1, w);
+        addShifted(r, 2 * n, 2 * k, rm1, w);
+        addShifted(r, 2 * n, 3 * k, rm2, w);
+    }
+
+    // r[0 .. 2n) = a * b for n-limb operands, scratch holds mulBalancedScratch(n) limbs.
+    inline void mulBalanced(Limb* r, const Limb* a, const Limb* b, size_t n, Limb* scratch) {
+        if (!useKaratsuba(n)) mulBasecase(r, a, n, b, n);
+        else if (!useToom3(n)) mulKaratsuba(r, a, b, n, scratch);
+        else if (!useNtt(n)) mulToom3(r, a, b, n, scratch);
+        else mulNtt(r, a, n, b, n);
+    }
+
+    // r[0 .. an+bn) = a * b for any an, bn >= 1; r must not overlap the inputs.
+    // Picks schoolbook, Karatsuba, Toom-3 or NTT by the size of the shorter operand.
+    inline void mul(Limb* r, const Limb* a, size_t an, const Limb* b, size_t bn) {
+        if (an < bn) {
+            std::swap(a, b);
+            std::swap(an, bn);
+        }
+        if (!useKaratsuba(bn)) {
+            mulBasecase(r, a, an, b, bn);
+            return;
+        }
+        if (useNtt(bn)) {
+            mulNtt(r, a, an, b, bn);
+            return;
+        }
+        // One scratch buffer for the whole product; longer operands are cut into bn-limb chunks.
+        LimbBuffer scratch(3 * bn + mulBalancedScratch(bn));
+        Limb* chunk = scratch.data();
+        Limb* prod = chunk + bn;
+        Limb* next = prod + 2 * bn;
+        mulBalanced(r, a, b, bn, next);
+        for (size_t off = bn; off < an; off += bn) {
+            size_t len = std::min(bn, an - off);
+            if (len == bn) {
+                mulBalanced(prod, a + off, b, bn, next);
+            }
+            else if (!useKaratsuba(len)) {
+                mulBasecase(prod, b, bn, a + off, len);
+            }
+            else {
+                std::copy(a + off, a + off + len, chunk);
+                std::fill(chunk + len, chunk + bn, 0);
+                mulBalanced(prod, chunk, b, bn, next);
+            }
+            Limb carry = addN(r + off, r + off, prod, bn);
+            std::copy(prod + bn, prod + bn + len, r + off + bn);
+            add(r + off + bn, r + off + bn, len, &carry, 1);
+        }
+    }
+}
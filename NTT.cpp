@@ -0,0 +1,275 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "Limbs.cpp"
+#include "ThreadPool.cpp"
+
+// Products whose shorter operand reaches this many limbs go through the number-theoretic transform.
+#ifndef BIGINT_NTT_THRESHOLD
+#define BIGINT_NTT_THRESHOLD 8192
+#endif
+
+namespace mpn {
+
+    // Transforms at least this long split into tasks when a pool is available.
+    const size_t NTT_PARALLEL_POINTS = size_t(1) << 14;
+
+    // Arithmetic modulo an NTT prime p < 2^63 in Montgomery form with R = 2^64.
+    struct NttPrime {
+        Limb p;
+        Limb pinv;      // -p^-1 mod R
+        Limb r2;        // R^2 mod p
+        Limb one;       // R mod p
+        Limb root;      // primitive 2^maxLog-th root of unity, Montgomery form
+        int maxLog;
+
+        NttPrime(Limb p, int twoAdicity, Limb generator) : p(p), maxLog(twoAdicity) {
+            Limb inv = p;                           // Newton iteration for p^-1 mod 2^64
+            for (int i = 0; i < 6; ++i) inv *= 2 - p * inv;
+            pinv = ~inv + 1;
+            Limb rem;
+            divWide(1, 0, p, rem);
+            one = rem;
+            Limb hi;
+            Limb lo = mulWide(one, one, hi);
+            divWide(hi, lo, p, rem);
+            r2 = rem;
+            root = pow(toMont(generator), (p - 1) >> twoAdicity);
+        }
+
+        Limb reduce(Limb hi, Limb lo) const {
+            Limb m = lo * pinv;
+            Limb mh;
+            Limb ml = mulWide(m, p, mh);
+            Limb carry = (lo + ml) < lo;
+            Limb t = hi + mh + carry;
+            return t >= p ? t - p : t;
+        }
+
+        Limb mul(Limb a, Limb b) const {
+            Limb hi;
+            Limb lo = mulWide(a, b, hi);
+            return reduce(hi, lo);
+        }
+
+        Limb add(Limb a, Limb b) const {
+            Limb s = a + b;
+            return s >= p ? s - p : s;
+        }
+
+        Limb sub(Limb a, Limb b) const {
+            return a >= b ? a - b : a + p - b;
+        }
+
+        // any word reduced mod p; p > 2^62 so three subtractions at most
+        Limb reduceWord(Limb a) const {
+            while (a >= p) a -= p;
+            return a;
+        }
+
+        Limb toMont(Limb a) const { return mul(reduceWord(a), r2); }
+        Limb fromMont(Limb a) const { return reduce(0, a); }
+
+        Limb pow(Limb base, Limb e) const {
+            Limb result = one;
+            while (e) {
+                if (e & 1) result = mul(result, base);
+                base = mul(base, base);
+                e >>= 1;
+            }
+            return result;
+        }
+
+        Limb inverse(Limb a) const {
+            return pow(a, p - 2);
+        }
+
+        // primitive 2^logn-th root of unity (or its inverse), Montgomery form
+        Limb rootOfUnity(int logn, bool inverted) const {
+            Limb w = root;
+            for (int i = logn; i < maxLog; ++i) w = mul(w, w);
+            return inverted ? inverse(w) : w;
+        }
+
+        // Twiddles for every butterfly size of a length-n transform, laid out so that the
+        // half-length-h stage reads its h factors contiguously from roots[h ..).
+        LimbBuffer twiddles(size_t n, int logn, bool inverted) const {
+            LimbBuffer roots(std::max<size_t>(n, 2));
+            for (size_t half = n / 2, lg = logn; half >= 1; half >>= 1, --lg) {
+                Limb w = rootOfUnity(int(lg), inverted);
+                roots[half] = one;
+                for (size_t j = 1; j < half; ++j) roots[half + j] = mul(roots[half + j - 1], w);
+            }
+            return roots;
+        }
+
+        // Gentleman-Sande, natural order in, bit-reversed order out. After the first stage the two
+        // halves are independent transforms, so with a pool they run as separate tasks.
+        void forwardTransform(Limb* a, size_t n, const LimbBuffer& roots, ThreadPool* pool) const {
+            if (pool != nullptr && n >= NTT_PARALLEL_POINTS) {
+                size_t half = n / 2;
+                butterflies(a, half, roots, pool, false);
+                TaskGroup group(pool);
+                group.run([this, a, half, &roots, pool] { forwardTransform(a, half, roots, pool); });
+                forwardTransform(a + half, half, roots, pool);
+                group.wait();
+                return;
+            }
+            for (size_t half = n / 2; half >= 1; half >>= 1) {
+                const Limb* w = roots.data() + half;
+                for (size_t i = 0; i < n; i += 2 * half) {
+                    for (size_t j = 0; j < half; ++j) {
+                        Limb u = a[i + j];
+                        Limb v = a[i + j + half];
+                        a[i + j] = add(u, v);
+                        a[i + j + half] = mul(sub(u, v), w[j]);
+                    }
+                }
+            }
+        }
+
+        // Cooley-Tukey, bit-reversed order in, natural order out, without the 1/n factor.
+        void inverseTransform(Limb* a, size_t n, const LimbBuffer& roots, ThreadPool* pool) const {
+            if (pool != nullptr && n >= NTT_PARALLEL_POINTS) {
+                size_t half = n / 2;
+                TaskGroup group(pool);
+                group.run([this, a, half, &roots, pool] { inverseTransform(a, half, roots, pool); });
+                inverseTransform(a + half, half, roots, pool);
+                group.wait();
+                butterflies(a, half, roots, pool, true);
+                return;
+            }
+            for (size_t half = 1; half < n; half <<= 1) {
+                const Limb* w = roots.data() + half;
+                for (size_t i = 0; i < n; i += 2 * half) {
+                    for (size_t j = 0; j < half; ++j) {
+                        Limb u = a[i + j];
+                        Limb v = mul(a[i + j + half], w[j]);
+                        a[i + j] = add(u, v);
+                        a[i + j + half] = sub(u, v);
+                    }
+                }
+            }
+        }
+
+        // The single top stage of a transform of 2 * half points, cut into one slice per thread.
+        void butterflies(Limb* a, size_t half, const LimbBuffer& roots, ThreadPool* pool, bool inverse) const {
+            const Limb* w = roots.data() + half;
+            size_t slice = (half + pool->size() - 1) / pool->size();
+            TaskGroup group(pool);
+            for (size_t from = 0; from < half; from += slice) {
+                size_t to = std::min(half, from + slice);
+                group.run([this, a, half, w, from, to, inverse] {
+                    for (size_t j = from; j < to; ++j) {
+                        Limb u = a[j];
+                        if (inverse) {
+                            Limb v = mul(a[j + half], w[j]);
+                            a[j] = add(u, v);
+                            a[j + half] = sub(u, v);
+                        }
+                        else {
+                            Limb v = a[j + half];
+                            a[j] = add(u, v);
+                            a[j + half] = mul(sub(u, v), w[j]);
+                        }
+                    }
+                });
+            }
+            group.wait();
+        }
+
+        // c[0 .. n) = cyclic convolution of a and b modulo p, in standard form
+        void convolve(Limb* c, const Limb* a, size_t an, const Limb* b, size_t bn, size_t n, int logn,
+                      ThreadPool* pool) const {
+            bool square = a == b && an == bn;
+            LimbBuffer roots = twiddles(n, logn, false);
+            LimbBuffer t(square ? 0 : n, 0);
+            TaskGroup group(pool);
+            if (!square) {
+                group.run([&] {
+                    for (size_t i = 0; i < bn; ++i) t[i] = reduceWord(b[i]);
+                    forwardTransform(t.data(), n, roots, pool);
+                });
+            }
+            for (size_t i = 0; i < an; ++i) c[i] = reduceWord(a[i]);
+            std::fill(c + an, c + n, 0);
+            forwardTransform(c, n, roots, pool);
+            group.wait();
+            if (square) {
+                for (size_t i = 0; i < n; ++i) c[i] = mul(c[i], c[i]);
+            }
+            else {
+                for (size_t i = 0; i < n; ++i) c[i] = mul(c[i], t[i]);
+            }
+            inverseTransform(c, n, twiddles(n, logn, true), pool);
+            // pointwise products carry an extra R^-1, so scale by R^2 / n to land in standard form
+            Limb scale = mul(r2, inverse(toMont(n)));
+            for (size_t i = 0; i < n; ++i) c[i] = mul(c[i], scale);
+        }
+    };
+
+    inline const NttPrime* nttPrimes() {
+        static const NttPrime primes[3] = {
+            NttPrime(0x5700000000000001ULL, 56, 5),
+            NttPrime(0x4180000000000001ULL, 55, 3),
+            NttPrime(0x6280000000000001ULL, 55, 3),
+        };
+        return primes;
+    }
+
+    // r[0 .. an+bn) = a * b, exact as long as an + bn < 2^55.
+    // Every limb is one coefficient; the convolution terms stay below p1*p2*p3, so CRT recovers them.
+    inline void mulNtt(Limb* r, const Limb* a, size_t an, const Limb* b, size_t bn) {
+        BIGINT_PROBE(MulNtt, an + bn);
+        const NttPrime* primes = nttPrimes();
+        const NttPrime& p1 = primes[0];
+        const NttPrime& p2 = primes[1];
+        const NttPrime& p3 = primes[2];
+
+        size_t rn = an + bn;
+        int logn = 0;
+        while ((size_t(1) << logn) < rn - 1) ++logn;
+        size_t n = size_t(1) << logn;
+
+        // the three residue products are independent
+        LimbBuffer c1(n), c2(n), c3(n);
+        ThreadPool* pool = parallelPool(std::min(an, bn));
+        TaskGroup group(pool);
+        group.run([&] { p1.convolve(c1.data(), a, an, b, bn, n, logn, pool); });
+        group.run([&] { p2.convolve(c2.data(), a, an, b, bn, n, logn, pool); });
+        p3.convolve(c3.data(), a, an, b, bn, n, logn, pool);
+        group.wait();
+
+        // Garner: x = v1 + p1 * v2 + p1 * p2 * v3
+        const Limb inv1mod2 = p2.inverse(p2.toMont(p1.p));
+        const Limb inv12mod3 = p3.inverse(p3.mul(p3.toMont(p1.p), p3.toMont(p2.p)));
+        const Limb p1mod3 = p3.toMont(p1.p);
+        Limb p12[2];
+        p12[0] = mulWide(p1.p, p2.p, p12[1]);
+
+        Limb acc[4] = { 0, 0, 0, 0 };
+        for (size_t i = 0; i < rn; ++i) {
+            if (i + 1 < rn) {
+                Limb v1 = c1[i];
+                Limb v2 = p2.mul(p2.sub(c2[i], p2.reduceWord(v1)), inv1mod2);
+                Limb t = p3.sub(p3.sub(c3[i], p3.reduceWord(v1)), p3.mul(p3.reduceWord(v2), p1mod3));
+                Limb v3 = p3.mul(t, inv12mod3);
+
+                Limb x[4];
+                x[0] = mulWide(v2, p1.p, x[1]);
+                x[2] = 0;
+                x[3] = 0;
+                Limb y[3];
+                y[2] = mul1(y, p12, 2, v3);
+                add(x, x, 4, y, 3);
+                add(x, x, 4, &v1, 1);
+                add(acc, acc, 4, x, 4);
+            }
+            r[i] = acc[0];
+            acc[0] = acc[1];
+            acc[1] = acc[2];
+            acc[2] = acc[3];
+            acc[3] = 0;
+        }
+    }
+}
@@ -0,0 +1,436 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "Montgomery.cpp"
+#include "Barrett.cpp"
+#include "Bitwise.cpp"
+
+// Batched exponentiations whose modulus has at most this many limbs run POW_LANES at a time
+// in lockstep; longer moduli keep the multiplier busy on their own.
+#ifndef BIGINT_BATCH_LANE_LIMBS
+#define BIGINT_BATCH_LANE_LIMBS 2
+#endif
+
+namespace mpn {
+
+    // Window width that minimises multiplications for an exponent of this many bits.
+    inline unsigned powWindowBits(size_t bits) {
+        if (bits > 671) return 6;
+        if (bits > 239) return 5;
+        if (bits > 79) return 4;
+        if (bits > 23) return 3;
+        return 1;
+    }
+
+    // r = b^e in the context's residue form, left-to-right sliding window over the
+    // exponent bits; the table holds the odd powers b, b^3, ..., b^(2^k - 1).
+    template <class Context>
+    void powModSlidingWindow(Limb* r, const Limb* b, const Limb* e, size_t en, const Context& ctx) {
+        BIGINT_PROBE(PowModSlidingWindow, ctx.size() + en);
+        size_t n = ctx.size();
+        size_t bits = bitLength(e, en);
+        std::copy(ctx.one(), ctx.one() + n, r);
+        if (bits == 0) return;
+
+        unsigned k = powWindowBits(bits);
+        LimbBuffer scratch(ctx.scratchSize());
+        LimbBuffer table(n << (k - 1));
+        std::copy(b, b + n, table.begin());
+        if (k > 1) {
+            LimbBuffer square(n);
+            ctx.sqr(square.data(), b, scratch.data());
+            for (size_t i = 1; i < (size_t(1) << (k - 1)); ++i) {
+                ctx.mul(&table[i * n], &table[(i - 1) * n], square.data(), scratch.data());
+            }
+        }
+
+        bool first = true;
+        size_t i = bits;
+        while (i-- > 0) {
+            if (!testBit(e, i)) {
+                if (!first) ctx.sqr(r, r, scratch.data());
+                continue;
+            }
+            size_t low = i + 1 >= k ? i + 1 - k : 0;
+            while (!testBit(e, low)) ++low;
+            unsigned width = unsigned(i - low + 1);
+            unsigned window = extractBits(e, en, low, width);
+            const Limb* power = &table[(window >> 1) * n];
+            if (first) {
+                std::copy(power, power + n, r);
+                first = false;
+            }
+            else {
+                for (unsigned j = 0; j < width; ++j) ctx.sqr(r, r, scratch.data());
+                ctx.mul(r, r, power, scratch.data());
+            }
+            i = low;
+        }
+    }
+
+    // Fixed k-bit windows over all en limbs of e. Every window costs k squarings and one
+    // multiplication, and the table entry is picked by a masked scan of the whole table, so
+    // neither the sequence of operations nor the memory access pattern depends on e.
+    template <class Context>
+    void powModFixedWindow(Limb* r, const Limb* b, const Limb* e, size_t en, const Context& ctx) {
+        BIGINT_PROBE(PowModFixedWindow, ctx.size() + en);
+        const unsigned k = 4;
+        const size_t entries = size_t(1) << k;
+        size_t n = ctx.size();
+        LimbBuffer scratch(ctx.scratchSize());
+        LimbBuffer table(entries * n);
+        LimbBuffer selected(n);
+        std::copy(ctx.one(), ctx.one() + n, table.begin());
+        for (size_t i = 1; i < entries; ++i) {
+            ctx.mul(&table[i * n], &table[(i - 1) * n], b, scratch.data());
+        }
+
+        std::copy(ctx.one(), ctx.one() + n, r);
+        for (size_t low = en * LIMB_BITS; low > 0;) {
+            low -= k;
+            for (unsigned j = 0; j < k; ++j) ctx.sqr(r, r, scratch.data());
+            Limb window = extractBits(e, en, low, k);
+            std::fill(selected.begin(), selected.end(), 0);
+            for (size_t i = 0; i < entries; ++i) {
+                Limb mask = 0 - Limb(((i ^ window) - 1) >> (LIMB_BITS - 1));
+                for (size_t j = 0; j < n; ++j) selected[j] |= table[i * n + j] & mask;
+            }
+            ctx.mul(r, r, selected.data(), scratch.data());
+        }
+    }
+
+    const size_t POW_LANES = 4;
+
+    // Montgomery products of POW_LANES operand pairs modulo the same N, stored lane-interleaved:
+    // limb j of lane l at x[j * POW_LANES + l]. Each step of the CIOS loop is done for every
+    // lane before the next, so the lanes' independent carry chains overlap. t needs
+    // (n + 2) * POW_LANES limbs; r may alias a or b.
+    inline void montgomeryMulLanes(Limb* r, const Limb* a, const Limb* b, const MontgomeryContext& ctx, Limb* t) {
+        const size_t L = POW_LANES;
+        size_t n = ctx.size();
+        const Limb* mod = ctx.modulus();
+        std::fill(t, t + (n + 2) * L, 0);
+        for (size_t i = 0; i < n; ++i) {
+            Limb carry[L], m[L];
+            for (size_t l = 0; l < L; ++l) carry[l] = 0;
+            for (size_t j = 0; j < n; ++j) {
+                for (size_t l = 0; l < L; ++l) {
+                    Limb hi;
+                    Limb lo = mulWide(a[j * L + l], b[i * L + l], hi);
+                    lo += carry[l];
+                    hi += lo < carry[l];
+                    Limb& x = t[j * L + l];
+                    x += lo;
+                    carry[l] = hi + (x < lo);
+                }
+            }
+            for (size_t l = 0; l < L; ++l) {
+                Limb& x = t[n * L + l];
+                x += carry[l];
+                t[(n + 1) * L + l] = x < carry[l];
+                m[l] = t[l] * ctx.n0();
+                Limb hi;
+                Limb lo = mulWide(m[l], mod[0], hi);
+                carry[l] = hi + (t[l] + lo < lo);
+            }
+            for (size_t j = 1; j < n; ++j) {
+                for (size_t l = 0; l < L; ++l) {
+                    Limb hi;
+                    Limb lo = mulWide(m[l], mod[j], hi);
+                    lo += carry[l];
+                    hi += lo < carry[l];
+                    lo += t[j * L + l];
+                    hi += lo < t[j * L + l];
+                    t[(j - 1) * L + l] = lo;
+                    carry[l] = hi;
+                }
+            }
+            for (size_t l = 0; l < L; ++l) {
+                Limb top = t[n * L + l] + carry[l];
+                t[(n - 1) * L + l] = top;
+                t[n * L + l] = t[(n + 1) * L + l] + (top < carry[l]);
+            }
+        }
+        // t < 2N in every lane; subtract N where that does not borrow
+        for (size_t l = 0; l < L; ++l) {
+            Limb borrow = 0;
+            for (size_t j = 0; j < n; ++j) {
+                Limb x = t[j * L + l];
+                Limb d = x - mod[j] - borrow;
+                borrow = (x < mod[j]) | ((x == mod[j]) & borrow);
+                r[j * L + l] = d;
+            }
+            if (borrow & ~t[n * L + l] & 1) {
+                for (size_t j = 0; j < n; ++j) r[j * L + l] = t[j * L + l];
+            }
+        }
+    }
+
+    // r = b^e[l] in every lane for lane-interleaved Montgomery-form bases sharing ctx; e[l] has
+    // en[l] limbs. Fixed k-bit windows run in lockstep over the longest exponent, a lane whose
+    // window is zero multiplies by one, and a window that is zero in every lane is skipped.
+    inline void powModLanes(Limb* r, const Limb* b, const Limb* const* e, const size_t* en, const MontgomeryContext& ctx) {
+        BIGINT_PROBE(PowModLanes, POW_LANES * ctx.size());
+        const size_t L = POW_LANES;
+        size_t n = ctx.size();
+        size_t bits = 0;
+        for (size_t l = 0; l < L; ++l) bits = std::max(bits, bitLength(e[l], en[l]));
+        for (size_t j = 0; j < n; ++j) {
+            for (size_t l = 0; l < L; ++l) r[j * L + l] = ctx.one()[j];
+        }
+        if (bits == 0) return;
+
+        unsigned k = std::min(powWindowBits(bits), 4u);
+        size_t width = n * L;
+        LimbBuffer scratch((n + 2) * L);
+        LimbBuffer table(width << k);
+        LimbBuffer selected(width);
+        std::copy(r, r + width, table.begin());
+        std::copy(b, b + width, table.begin() + width);
+        for (size_t i = 2; i < (size_t(1) << k); ++i) {
+            montgomeryMulLanes(&table[i * width], &table[(i - 1) * width], b, ctx, scratch.data());
+        }
+
+        bool first = true;
+        for (size_t low = (bits - 1) / k * k + k; low > 0;) {
+            low -= k;
+            if (!first) {
+                for (unsigned j = 0; j < k; ++j) montgomeryMulLanes(r, r, r, ctx, scratch.data());
+            }
+            unsigned window[L];
+            unsigned any = 0;
+            for (size_t l = 0; l < L; ++l) {
+                window[l] = extractBits(e[l], en[l], low, k);
+                any |= window[l];
+            }
+            if (any == 0) continue;
+            for (size_t j = 0; j < n; ++j) {
+                for (size_t l = 0; l < L; ++l) selected[j * L + l] = table[window[l] * width + j * L + l];
+            }
+            if (first) {
+                std::copy(selected.begin(), selected.end(), r);
+                first = false;
+            }
+            else {
+                montgomeryMulLanes(r, r, selected.data(), ctx, scratch.data());
+            }
+        }
+    }
+
+    // r = r * a in residue form, or r = a when r still stands for one
+    template <class Context>
+    void mulInto(Limb* r, bool& isOne, const Limb* a, const Context& ctx, Limb* scratch) {
+        if (isOne) std::copy(a, a + ctx.size(), r);
+        else ctx.mul(r, r, a, scratch);
+        isOne = false;
+    }
+
+    // r = b[0]^e[0] * ... * b[count-1]^e[count-1] in the context's residue form, Straus's
+    // method: every exponent gets its own sliding windows and table of odd powers, as in
+    // powModSlidingWindow, but all of them share one run of squarings and each window is
+    // multiplied in when the scan reaches its low bit. Shamir's trick is the one-bit case.
+    template <class Context>
+    void multiPowStraus(Limb* r, const Limb* const* b, const Limb* const* e, const size_t* en, size_t count,
+        const Context& ctx) {
+        BIGINT_PROBE(PowModStraus, ctx.size() * count);
+        struct Window {
+            size_t low;
+            const Limb* power;
+        };
+        size_t n = ctx.size();
+        LimbBuffer scratch(ctx.scratchSize());
+        std::vector<LimbBuffer> tables(count);
+        std::vector<Window> windows;
+        LimbBuffer square(n);
+        for (size_t t = 0; t < count; ++t) {
+            size_t bits = bitLength(e[t], en[t]);
+            if (bits == 0) continue;
+            unsigned k = powWindowBits(bits);
+            LimbBuffer& table = tables[t];
+            table.resize(n << (k - 1));
+            std::copy(b[t], b[t] + n, table.begin());
+            if (k > 1) ctx.sqr(square.data(), b[t], scratch.data());
+            for (size_t i = 1; i < (size_t(1) << (k - 1)); ++i) {
+                ctx.mul(&table[i * n], &table[(i - 1) * n], square.data(), scratch.data());
+            }
+            for (size_t i = bits; i-- > 0;) {
+                if (!testBit(e[t], i)) continue;
+                size_t low = i + 1 >= k ? i + 1 - k : 0;
+                while (!testBit(e[t], low)) ++low;
+                unsigned window = extractBits(e[t], en[t], low, unsigned(i - low + 1));
+                windows.push_back({ low, &table[(window >> 1) * n] });
+                i = low;
+            }
+        }
+        std::stable_sort(windows.begin(), windows.end(), [](const Window& x, const Window& y) { return x.low > y.low; });
+
+        bool isOne = true;
+        size_t next = 0;
+        for (size_t i = windows.empty() ? 0 : windows[0].low + 1; i-- > 0;) {
+            if (!isOne) ctx.sqr(r, r, scratch.data());
+            for (; next < windows.size() && windows[next].low == i; ++next) {
+                mulInto(r, isOne, windows[next].power, ctx, scratch.data());
+            }
+        }
+        if (isOne) std::copy(ctx.one(), ctx.one() + n, r);
+    }
+
+    // Digit width minimising the products of Pippenger's method, which go to cost.
+    inline unsigned pippengerDigitBits(size_t bits, size_t count, double& cost) {
+        unsigned c = 1;
+        cost = 0;
+        for (unsigned k = 1; k <= 16; ++k) {
+            double products = double((bits + k - 1) / k) * double(count + (size_t(2) << k));
+            if (k == 1 || products < cost) {
+                c = k;
+                cost = products;
+            }
+        }
+        return c;
+    }
+
+    // The same product by Pippenger's bucket method. The exponents are cut into c-bit digits;
+    // per digit position every base is multiplied into the bucket of its digit, and the
+    // buckets fold into B[1] * B[2]^2 * ... through two running products. A position costs
+    // count + 2^(c+1) products and c shared squarings and needs no per-term tables, which
+    // beats Straus once the terms are many.
+    template <class Context>
+    void multiPowPippenger(Limb* r, const Limb* const* b, const Limb* const* e, const size_t* en, size_t count,
+        const Context& ctx) {
+        BIGINT_PROBE(PowModPippenger, ctx.size() * count);
+        size_t n = ctx.size();
+        size_t bits = 0;
+        for (size_t t = 0; t < count; ++t) bits = std::max(bits, bitLength(e[t], en[t]));
+        std::copy(ctx.one(), ctx.one() + n, r);
+        if (bits == 0) return;
+
+        double cost;
+        unsigned c = pippengerDigitBits(bits, count, cost);
+        size_t buckets = size_t(1) << c;
+        LimbBuffer scratch(ctx.scratchSize());
+        LimbBuffer bucket(buckets * n), running(n), total(n);
+        std::vector<char> filled(buckets);
+        bool isOne = true;
+        for (size_t low = (bits - 1) / c * c + c; low > 0;) {
+            low -= c;
+            if (!isOne) {
+                for (unsigned j = 0; j < c; ++j) ctx.sqr(r, r, scratch.data());
+            }
+            std::fill(filled.begin(), filled.end(), 0);
+            for (size_t t = 0; t < count; ++t) {
+                unsigned digit = extractBits(e[t], en[t], low, c);
+                if (digit == 0) continue;
+                bool empty = !filled[digit];
+                mulInto(&bucket[digit * n], empty, b[t], ctx, scratch.data());
+                filled[digit] = 1;
+            }
+            bool runningOne = true, totalOne = true;
+            for (size_t d = buckets; d-- > 1;) {
+                if (filled[d]) mulInto(running.data(), runningOne, &bucket[d * n], ctx, scratch.data());
+                if (!runningOne) mulInto(total.data(), totalOne, running.data(), ctx, scratch.data());
+            }
+            if (!totalOne) mulInto(r, isOne, total.data(), ctx, scratch.data());
+        }
+    }
+
+    // Whichever method needs fewer products: Straus's grow by a window table and bits / (k + 1)
+    // products per term, Pippenger's per-term share shrinks as the digits widen with the count.
+    template <class Context>
+    void multiPow(Limb* r, const Limb* const* b, const Limb* const* e, const size_t* en, size_t count,
+        const Context& ctx) {
+        size_t bits = 0;
+        double straus = 0;
+        for (size_t t = 0; t < count; ++t) {
+            size_t termBits = bitLength(e[t], en[t]);
+            unsigned k = powWindowBits(termBits);
+            bits = std::max(bits, termBits);
+            straus += double(termBits) / (k + 1) + double(size_t(1) << (k - 1));
+        }
+        double pippenger;
+        pippengerDigitBits(bits, count, pippenger);
+        if (pippenger < straus) multiPowPippenger(r, b, e, en, count, ctx);
+        else multiPowStraus(r, b, e, en, count, ctx);
+    }
+
+    // Lim-Lee comb tables for one fixed base in a context's residue form. An exponent of up to
+    // maxBits() bits is read as `teeth` rows of a bits, each cut into `tables` blocks of w
+    // bits; table j holds, for every mask of rows, the product of b^(2^(k a + j w)) over the
+    // rows k in it. An exponentiation then costs w squarings and at most tables * w products,
+    // about 1 / teeth of the squarings of an ordinary one, for tables * 2^teeth residues of
+    // memory and a one-off cost of a few ordinary exponentiations.
+    class FixedBaseComb {
+    public:
+        FixedBaseComb() : n(0), teeth(0), tables(0), rowBits(0), blockBits(0) {
+        }
+
+        template <class Context>
+        FixedBaseComb(const Limb* b, size_t bits, unsigned teeth, unsigned tables, const Context& ctx)
+            : n(ctx.size()), teeth(teeth), tables(tables) {
+            if (teeth < 1 || teeth > 16 || tables < 1) {
+                throw std::runtime_error("Comb needs 1 to 16 teeth and at least one table");
+            }
+            bits = std::max<size_t>(bits, 1);
+            rowBits = (bits + teeth - 1) / teeth;
+            blockBits = (rowBits + tables - 1) / tables;
+            size_t entries = size_t(1) << teeth;
+            LimbBuffer scratch(ctx.scratchSize());
+            entry.resize(tables * entries * n);
+            std::copy(ctx.one(), ctx.one() + n, &entry[0]);
+            std::copy(b, b + n, &entry[n]);
+            for (unsigned k = 1; k < teeth; ++k) {   // b^(2^(k a)) at mask 2^k
+                Limb* row = &entry[(size_t(1) << k) * n];
+                const Limb* previous = &entry[(size_t(1) << (k - 1)) * n];
+                std::copy(previous, previous + n, row);
+                for (size_t i = 0; i < rowBits; ++i) ctx.sqr(row, row, scratch.data());
+            }
+            for (size_t mask = 3; mask < entries; ++mask) {
+                size_t top = size_t(1) << (LIMB_BITS - 1 - countLeadingZeros(Limb(mask)));
+                if (mask == top) continue;
+                ctx.mul(&entry[mask * n], &entry[(mask ^ top) * n], &entry[top * n], scratch.data());
+            }
+            for (unsigned j = 1; j < tables; ++j) {
+                for (size_t mask = 0; mask < entries; ++mask) {
+                    Limb* x = &entry[(j * entries + mask) * n];
+                    const Limb* below = &entry[((j - 1) * entries + mask) * n];
+                    std::copy(below, below + n, x);
+                    for (size_t i = 0; i < blockBits; ++i) ctx.sqr(x, x, scratch.data());
+                }
+            }
+        }
+
+        size_t maxBits() const { return rowBits * teeth; }
+        size_t size() const { return n; }
+        const Limb* base() const { return &entry[n]; }
+
+        // r = b^e for an exponent of at most maxBits() bits
+        template <class Context>
+        void pow(Limb* r, const Limb* e, size_t en, const Context& ctx) const {
+            BIGINT_PROBE(PowModComb, n + en);
+            size_t entries = size_t(1) << teeth;
+            size_t available = en * LIMB_BITS;
+            LimbBuffer scratch(ctx.scratchSize());
+            bool isOne = true;
+            for (size_t t = blockBits; t-- > 0;) {
+                if (!isOne) ctx.sqr(r, r, scratch.data());
+                for (unsigned j = 0; j < tables; ++j) {
+                    size_t column = j * blockBits + t;
+                    if (column >= rowBits) continue;
+                    size_t mask = 0;
+                    for (unsigned k = 0; k < teeth; ++k) {
+                        size_t bit = k * rowBits + column;
+                        if (bit < available && testBit(e, bit)) mask |= size_t(1) << k;
+                    }
+                    if (mask != 0) mulInto(r, isOne, &entry[(j * entries + mask) * n], ctx, scratch.data());
+                }
+            }
+            if (isOne) std::copy(ctx.one(), ctx.one() + n, r);
+        }
+
+    private:
+        size_t n;
+        unsigned teeth, tables;
+        size_t rowBits, blockBits;
+        LimbBuffer entry;                     // tables * 2^teeth residues of n limbs
+    };
+}
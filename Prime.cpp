@@ -0,0 +1,301 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "Montgomery.cpp"
+#include "PowMod.cpp"
+
+// Trial division and the nextPrime sieve use the odd primes below this bound.
+#ifndef BIGINT_PRIME_SIEVE_BOUND
+#define BIGINT_PRIME_SIEVE_BOUND 8192
+#endif
+
+namespace mpn {
+
+    // Odd primes below BIGINT_PRIME_SIEVE_BOUND, by the sieve of Eratosthenes.
+    inline const LimbBuffer& smallPrimes() {
+        static const LimbBuffer primes = [] {
+            std::vector<char> composite(BIGINT_PRIME_SIEVE_BOUND, 0);
+            LimbBuffer found;
+            for (Limb p = 3; p < BIGINT_PRIME_SIEVE_BOUND; p += 2) {
+                if (composite[p]) continue;
+                found.push_back(p);
+                for (Limb m = p * p; m < BIGINT_PRIME_SIEVE_BOUND; m += 2 * p) composite[m] = 1;
+            }
+            return found;
+        }();
+        return primes;
+    }
+
+    // Runs of consecutive small primes whose product fits in a limb: one pass of word
+    // divisions by the product gives the remainders by all of them.
+    struct PrimeProduct {
+        Limb product;
+        size_t begin, end;
+    };
+
+    inline const std::vector<PrimeProduct>& primeProducts() {
+        static const std::vector<PrimeProduct> products = [] {
+            const LimbBuffer& primes = smallPrimes();
+            std::vector<PrimeProduct> found;
+            for (size_t i = 0; i < primes.size();) {
+                PrimeProduct run = { 1, i, i };
+                Limb hi;
+                while (run.end < primes.size() && (mulWide(run.product, primes[run.end], hi), hi == 0)) {
+                    run.product *= primes[run.end++];
+                }
+                found.push_back(run);
+                i = run.end;
+            }
+            return found;
+        }();
+        return products;
+    }
+
+    // a % d
+    inline Limb mod1(const Limb* a, size_t n, Limb d) {
+        Limb rem = 0;
+        for (size_t i = n; i-- > 0;) divWide(rem, a[i], d, rem);
+        return rem;
+    }
+
+    // Trial division pays off up to a bound that grows with the size of the number, since a
+    // Miller-Rabin round costs about bits^3 and a prime product one pass over the limbs.
+    inline Limb trialDivisionLimit(size_t bits) {
+        return Limb(std::min<size_t>(BIGINT_PRIME_SIEVE_BOUND, std::max<size_t>(256, 4 * bits)));
+    }
+
+    // residues[i] = a % smallPrimes()[i] for the primes below limit; returns how many there are
+    inline size_t smallPrimeResidues(Limb* residues, const Limb* a, size_t n, Limb limit) {
+        const LimbBuffer& primes = smallPrimes();
+        size_t count = 0;
+        for (const PrimeProduct& run : primeProducts()) {
+            if (primes[run.begin] >= limit) break;
+            Limb rem = mod1(a, n, run.product);
+            for (size_t i = run.begin; i < run.end && primes[i] < limit; ++i) residues[count++] = rem % primes[i];
+        }
+        return count;
+    }
+
+    // The least odd prime below limit dividing a, or 0 when there is none.
+    inline Limb smallFactor(const Limb* a, size_t n, Limb limit) {
+        const LimbBuffer& primes = smallPrimes();
+        for (const PrimeProduct& run : primeProducts()) {
+            if (primes[run.begin] >= limit) break;
+            Limb rem = mod1(a, n, run.product);
+            for (size_t i = run.begin; i < run.end && primes[i] < limit; ++i) {
+                if (rem % primes[i] == 0) return primes[i];
+            }
+        }
+        return 0;
+    }
+
+    // marks[i] = 1 when one of the first primeCount small primes divides start + 2i, for the
+    // odd start whose residues smallPrimeResidues gave. Only valid while start exceeds them.
+    inline void sieveOdd(std::vector<char>& marks, const Limb* residues, size_t primeCount) {
+        const LimbBuffer& primes = smallPrimes();
+        std::fill(marks.begin(), marks.end(), 0);
+        for (size_t j = 0; j < primeCount; ++j) {
+            Limb p = primes[j];
+            Limb first = (p - residues[j]) % p * ((p + 1) / 2) % p;  // -r / 2 mod p
+            for (size_t i = size_t(first); i < marks.size(); i += size_t(p)) marks[i] = 1;
+        }
+    }
+
+    // Whether q < 2^32 is prime, by trial division.
+    inline bool isPrimeWord(Limb q) {
+        if (q < 3) return q == 2;
+        if (q % 2 == 0) return false;
+        for (Limb p : smallPrimes()) {
+            if (p * p > q) return true;
+            if (q % p == 0) return false;
+        }
+        for (Limb f = BIGINT_PRIME_SIEVE_BOUND | 1; f * f <= q; f += 2) {
+            if (q % f == 0) return false;
+        }
+        return true;
+    }
+
+    // b^e mod q for q < 2^32
+    inline Limb powModWord(Limb b, Limb e, Limb q) {
+        Limb x = 1;
+        for (b %= q; e != 0; e >>= 1, b = b * b % q) {
+            if (e & 1) x = x * b % q;
+        }
+        return x;
+    }
+
+    // The x with x^p = a (mod 2^64) for odd a and odd p, unique since x -> x^p permutes the odd
+    // residues. x = a is right mod 8, and each Newton step x -= (x^p - a) / (p * x^(p-1))
+    // doubles the number of correct low bits.
+    inline Limb twoAdicRoot(Limb a, Limb p) {
+        Limb x = a;
+        for (int bits = 3; bits < LIMB_BITS; bits *= 2) {
+            Limb power = 1;
+            for (Limb b = x, e = p - 1; e != 0; e >>= 1, b *= b) {
+                if (e & 1) power *= b;
+            }
+            Limb d = p * power;
+            Limb inverse = d;                   // d * d = 1 (mod 8) for odd d
+            for (int i = 0; i < 5; ++i) inverse *= 2 - d * inverse;
+            x -= (power * x - a) * inverse;
+        }
+        return x;
+    }
+
+    // Jacobi symbol (a / m) for odd m
+    inline int jacobi(Limb a, Limb m) {
+        int result = 1;
+        a %= m;
+        while (a != 0) {
+            while ((a & 1) == 0) {
+                a >>= 1;
+                if ((m & 7) == 3 || (m & 7) == 5) result = -result;
+            }
+            std::swap(a, m);
+            if ((a & 3) == 3 && (m & 3) == 3) result = -result;
+            a %= m;
+        }
+        return m == 1 ? result : 0;
+    }
+
+    // (d / N) for odd d and odd N > |d|, through reciprocity down to one word division.
+    inline int jacobi(long long d, const Limb* N, size_t n) {
+        Limb magnitude = d < 0 ? Limb(0) - Limb(d) : Limb(d);
+        int result = d < 0 && (N[0] & 3) == 3 ? -1 : 1;
+        if ((magnitude & 3) == 3 && (N[0] & 3) == 3) result = -result;
+        return result * jacobi(mod1(N, n, magnitude), magnitude);
+    }
+
+    // Residue arithmetic on values below the context's modulus, in either form.
+    inline void addMod(Limb* r, const Limb* a, const Limb* b, const MontgomeryContext& ctx) {
+        size_t n = ctx.size();
+        Limb carry = addN(r, a, b, n);
+        if (carry != 0 || cmp(r, ctx.modulus(), n) >= 0) subN(r, r, ctx.modulus(), n);
+    }
+
+    inline void subMod(Limb* r, const Limb* a, const Limb* b, const MontgomeryContext& ctx) {
+        size_t n = ctx.size();
+        if (subN(r, a, b, n) != 0) addN(r, r, ctx.modulus(), n);
+    }
+
+    inline void halfMod(Limb* r, const Limb* a, const MontgomeryContext& ctx) {
+        size_t n = ctx.size();
+        Limb carry = 0;
+        if (a[0] & 1) carry = addN(r, a, ctx.modulus(), n);
+        else std::copy(a, a + n, r);
+        rshift(r, r, n, 1);
+        r[n - 1] |= carry << 63;
+    }
+
+    inline bool isZero(const Limb* a, size_t n) {
+        return normalizedSize(a, n) == 0;
+    }
+
+    // Leaves d in a = d * 2^s, a nonzero, and returns s.
+    inline size_t removeTwos(Limb* a, size_t n) {
+        size_t zeros = 0;
+        while (a[zeros] == 0) ++zeros;
+        unsigned bits = unsigned(countTrailingZeros(a[zeros]));
+        std::copy(a + zeros, a + n, a);
+        std::fill(a + n - zeros, a + n, 0);
+        if (bits != 0) rshift(a, a, n - zeros, bits);
+        return zeros * LIMB_BITS + bits;
+    }
+
+    // The Montgomery form of a small signed value, |value| < N
+    inline LimbBuffer smallResidue(long long value, const MontgomeryContext& ctx, Limb* scratch) {
+        size_t n = ctx.size();
+        LimbBuffer r(n, 0);
+        r[0] = value < 0 ? Limb(0) - Limb(value) : Limb(value);
+        ctx.toMontgomery(r.data(), r.data(), scratch);
+        if (value < 0 && !isZero(r.data(), n)) subN(r.data(), ctx.modulus(), r.data(), n);
+        return r;
+    }
+
+    // Strong probable-prime test of the odd N > 3 behind ctx to the base b, 1 < b < N - 1:
+    // with N - 1 = d * 2^s, either b^d = 1 or b^(d * 2^i) = -1 for some i < s.
+    inline bool millerRabin(const MontgomeryContext& ctx, const Limb* b) {
+        BIGINT_PROBE(MillerRabin, ctx.size());
+        size_t n = ctx.size();
+        LimbBuffer d(ctx.modulus(), ctx.modulus() + n);
+        d[0] -= 1;
+        size_t s = removeTwos(d.data(), n);
+
+        LimbBuffer scratch(ctx.scratchSize());
+        LimbBuffer base(n), x(n), minusOne(n);
+        subN(minusOne.data(), ctx.modulus(), ctx.one(), n);
+        ctx.toMontgomery(base.data(), b, scratch.data());
+        powModSlidingWindow(x.data(), base.data(), d.data(), normalizedSize(d.data(), n), ctx);
+        if (cmp(x.data(), ctx.one(), n) == 0 || cmp(x.data(), minusOne.data(), n) == 0) return true;
+        for (size_t i = 1; i < s; ++i) {
+            ctx.sqr(x.data(), x.data(), scratch.data());
+            if (cmp(x.data(), minusOne.data(), n) == 0) return true;
+            if (cmp(x.data(), ctx.one(), n) == 0) return false;
+        }
+        return false;
+    }
+
+    // Strong Lucas probable-prime test of the odd N behind ctx, which must not be a square
+    // and must exceed every small D tried. Selfridge's parameters: the first D in 5, -7, 9,
+    // -11, ... with (D / N) = -1, P = 1 and Q = (1 - D) / 4. With N + 1 = d * 2^s, either
+    // U_d = 0 or V_(d * 2^i) = 0 for some i < s. Everything runs on Montgomery residues.
+    inline bool strongLucas(const MontgomeryContext& ctx) {
+        BIGINT_PROBE(StrongLucas, ctx.size());
+        size_t n = ctx.size();
+        const Limb* N = ctx.modulus();
+        long long D = 5;
+        for (;;) {
+            int symbol = jacobi(D, N, n);
+            if (symbol == -1) break;
+            if (symbol == 0) return false;
+            D = D < 0 ? 2 - D : -2 - D;
+        }
+
+        LimbBuffer scratch(ctx.scratchSize());
+        LimbBuffer d(n + 1, 0);
+        std::copy(N, N + n, d.begin());
+        Limb one = 1;
+        add(d.data(), d.data(), n + 1, &one, 1);
+        size_t s = removeTwos(d.data(), n + 1);
+        size_t dn = normalizedSize(d.data(), n + 1);
+
+        LimbBuffer Dm = smallResidue(D, ctx, scratch.data());
+        LimbBuffer Qm = smallResidue((1 - D) / 4, ctx, scratch.data());
+        LimbBuffer U(ctx.one(), ctx.one() + n), V(U), Qk(Qm), t(n);
+        for (size_t i = bitLength(d.data(), dn) - 1; i-- > 0;) {
+            ctx.mul(U.data(), U.data(), V.data(), scratch.data());      // U_2k = U_k V_k
+            ctx.sqr(V.data(), V.data(), scratch.data());                // V_2k = V_k^2 - 2 Q^k
+            subMod(V.data(), V.data(), Qk.data(), ctx);
+            subMod(V.data(), V.data(), Qk.data(), ctx);
+            ctx.sqr(Qk.data(), Qk.data(), scratch.data());
+            if (!testBit(d.data(), i)) continue;
+            ctx.mul(t.data(), Dm.data(), U.data(), scratch.data());     // U_k+1 = (U_k + V_k) / 2
+            addMod(U.data(), U.data(), V.data(), ctx);                  // V_k+1 = (D U_k + V_k) / 2
+            halfMod(U.data(), U.data(), ctx);
+            addMod(V.data(), V.data(), t.data(), ctx);
+            halfMod(V.data(), V.data(), ctx);
+            ctx.mul(Qk.data(), Qk.data(), Qm.data(), scratch.data());
+        }
+        if (isZero(U.data(), n) || isZero(V.data(), n)) return true;
+        for (size_t i = 1; i < s; ++i) {
+            ctx.sqr(V.data(), V.data(), scratch.data());
+            subMod(V.data(), V.data(), Qk.data(), ctx);
+            subMod(V.data(), V.data(), Qk.data(), ctx);
+            if (isZero(V.data(), n)) return true;
+            ctx.sqr(Qk.data(), Qk.data(), scratch.data());
+        }
+        return false;
+    }
+
+    // w = a base in [2, N - 2] drawn from the seed by splitmix64, for N > 4 of n limbs.
+    inline void randomWitness(Limb* w, const Limb* N, size_t n, Limb seed) {
+        for (size_t i = 0; i < n; ++i) {
+            Limb z = (seed += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            w[i] = z ^ (z >> 31);
+        }
+        w[n - 1] %= N[n - 1];                   // below N, as the top limb is smaller
+        if (normalizedSize(w, n) <= 1 && w[0] < 2) w[0] += 2;
+    }
+}
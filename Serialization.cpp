@@ -0,0 +1,139 @@
+#pragma once
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "Limbs.cpp"
+#include "Decimal.cpp"
+
+// Binary form of a BigInt, version 1:
+//   bytes 0-3   magic "BIGI"
+//   byte  4     version
+//   byte  5     flags, bit 0 set for a negative value
+//   bytes 6-7   zero
+//   bytes 8-15  limb count n, little-endian
+//   then        n limbs, each 8 bytes little-endian, least significant first
+// The header keeps the limbs 8-byte aligned whenever the buffer is, so a file mapped into
+// memory can be read in place through a BigIntView.
+namespace mpn {
+
+    const unsigned char SERIAL_MAGIC[4] = { 'B', 'I', 'G', 'I' };
+    const unsigned char SERIAL_VERSION = 1;
+    const unsigned char SERIAL_NEGATIVE = 1;
+    const size_t SERIAL_HEADER_BYTES = 16;
+
+    inline bool littleEndianHost() {
+        const Limb one = 1;
+        unsigned char low;
+        std::memcpy(&low, &one, 1);
+        return low == 1;
+    }
+
+    inline size_t serializedSize(size_t n) {
+        return SERIAL_HEADER_BYTES + n * sizeof(Limb);
+    }
+
+    inline void storeLimb(unsigned char* out, Limb x) {
+        for (int i = 0; i < 8; ++i) out[i] = (unsigned char)(x >> (8 * i));
+    }
+
+    inline Limb loadLimb(const unsigned char* in) {
+        Limb x = 0;
+        for (int i = 0; i < 8; ++i) x |= Limb(in[i]) << (8 * i);
+        return x;
+    }
+
+    // Writes the header and limbs to out, which holds serializedSize(n) bytes.
+    inline unsigned char* serialize(unsigned char* out, const Limb* a, size_t n, bool negative) {
+        std::memcpy(out, SERIAL_MAGIC, 4);
+        out[4] = SERIAL_VERSION;
+        out[5] = negative && n != 0 ? SERIAL_NEGATIVE : 0;
+        out[6] = 0;
+        out[7] = 0;
+        storeLimb(out + 8, Limb(n));
+        out += SERIAL_HEADER_BYTES;
+        if (littleEndianHost()) {
+            std::memcpy(out, a, n * sizeof(Limb));
+        }
+        else {
+            for (size_t i = 0; i < n; ++i) storeLimb(out + i * sizeof(Limb), a[i]);
+        }
+        return out + n * sizeof(Limb);
+    }
+
+    // Checks the header of [first, last) and returns the limb count and sign.
+    inline size_t readSerializedHeader(const unsigned char* first, const unsigned char* last, bool& negative) {
+        size_t size = size_t(last - first);
+        if (size < SERIAL_HEADER_BYTES || std::memcmp(first, SERIAL_MAGIC, 4) != 0) {
+            throw std::runtime_error("Not a serialized BigInt");
+        }
+        if (first[4] != SERIAL_VERSION) {
+            throw std::runtime_error("Unsupported serialized BigInt version");
+        }
+        if ((first[5] & ~SERIAL_NEGATIVE) != 0 || first[6] != 0 || first[7] != 0) {
+            throw std::runtime_error("Not a serialized BigInt");
+        }
+        Limb n = loadLimb(first + 8);
+        if (n > (size - SERIAL_HEADER_BYTES) / sizeof(Limb)) {
+            throw std::runtime_error("Truncated serialized BigInt");
+        }
+        negative = (first[5] & SERIAL_NEGATIVE) != 0;
+        return size_t(n);
+    }
+}
+
+// Read-only, non-owning signed magnitude: limbs owned by a BigInt or lying in a buffer such as
+// a memory-mapped file. It mixes with BigInt in + - * / % and comparisons without copying the
+// operand, and must not outlive the memory it points into.
+class BigIntView {
+public:
+    BigIntView() : ptr(nullptr), count(0), isNegative(false) {
+    }
+
+    BigIntView(const Limb* limbs, size_t n, bool negative) : ptr(limbs), count(mpn::normalizedSize(limbs, n)),
+        isNegative(negative && count != 0) {
+    }
+
+    // Wraps serialized bytes in place. The limbs must be 8-byte aligned and the host
+    // little-endian; BigInt::deserialize copies instead and has neither requirement.
+    static BigIntView fromSerialized(const unsigned char* first, const unsigned char* last) {
+        bool negative;
+        size_t n = mpn::readSerializedHeader(first, last, negative);
+        const unsigned char* limbs = first + mpn::SERIAL_HEADER_BYTES;
+        if (!mpn::littleEndianHost() || reinterpret_cast<std::uintptr_t>(limbs) % alignof(Limb) != 0) {
+            throw std::runtime_error("Serialized limbs cannot be viewed in place");
+        }
+        return BigIntView(reinterpret_cast<const Limb*>(limbs), n, negative);
+    }
+
+    const Limb* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool negative() const { return isNegative; }
+    bool isZero() const { return count == 0; }
+
+    std::string toString() const {
+        std::string str(mpn::maxDecimalDigits(count) + 1, '\0');
+        char* out = &str[0];
+        if (isNegative) *out++ = '-';
+        str.resize(mpn::formatDecimal(out, ptr, count, 0) - str.data());
+        return str;
+    }
+
+    // -1, 0 or 1 as a is below, equal to or above b
+    friend int compare(const BigIntView& a, const BigIntView& b) {
+        if (a.isNegative != b.isNegative) return a.isNegative ? -1 : 1;
+        int c = a.count != b.count ? (a.count > b.count ? 1 : -1) : mpn::cmp(a.ptr, b.ptr, a.count);
+        return a.isNegative ? -c : c;
+    }
+
+    friend bool operator==(const BigIntView& a, const BigIntView& b) { return compare(a, b) == 0; }
+    friend bool operator!=(const BigIntView& a, const BigIntView& b) { return compare(a, b) != 0; }
+    friend bool operator<(const BigIntView& a, const BigIntView& b) { return compare(a, b) < 0; }
+    friend bool operator>(const BigIntView& a, const BigIntView& b) { return compare(a, b) > 0; }
+    friend bool operator<=(const BigIntView& a, const BigIntView& b) { return compare(a, b) <= 0; }
+    friend bool operator>=(const BigIntView& a, const BigIntView& b) { return compare(a, b) >= 0; }
+
+private:
+    const Limb* ptr;
+    size_t count;
+    bool isNegative;
+};
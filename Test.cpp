@@ -1,6 +1,33 @@
 #include "BigInt.cpp"
+#include <sstream>
+#include <chrono>
+#include "LazyExpression.cpp"
+#include "FixedWidth.cpp"
+#include "FixedBase.cpp"
 #include <cassert>
 
+static void TestSmallValues() {
+    LimbVector small(2, 7);
+    assert(small.capacity() == LimbVector::INLINE_LIMBS);
+    LimbVector large(small);
+    large.push_back(9);
+    assert(large.size() == 3 && large[0] == 7 && large[2] == 9);
+    LimbVector moved(std::move(large));
+    assert(moved.size() == 3 && large.empty());
+    small.swap(moved);
+    assert(small.size() == 3 && moved.size() == 2 && moved[1] == 7);
+    moved = small;
+    assert(moved == small);
+
+    assert(BigInt(0) == BigInt::zero());
+    assert(BigInt(-1234567890123LL) == BigInt("-1234567890123"));
+    assert(BigInt(-9223372036854775807LL - 1) == BigInt("-9223372036854775808"));
+    assert(BigInt::one() + BigInt::one() == BigInt::two());
+    BigInt big = BigInt("18446744073709551616") * BigInt("18446744073709551616");
+    assert(big - BigInt::one() == BigInt("340282366920938463463374607431768211455"));
+    std::cout << "SmallValues complete" << std::endl;
+}
+
 static void TestSum() {
     BigInt num1("7771661671012755446050643784636329069923851010293200090130872533132917890211520272189984488791");
     BigInt num2("987654321");
@@ -24,7 +51,7 @@ static void TestSub() {
     assert(num1-num2 == expected1);
     BigInt num3("-9519604441026697154840321303454275246551311007300714876688669951960444102669715484095196044410266971548403213034542752465513110073007148766886699519604441026697154840");
     BigInt num4("-12349519604441026697154840321303454275246551311007300714876688669951960444102669715484056789");
-    BigInt expected2("-9519604441026697154840321303454275246551311007300714876688669951960444102682065003699637071107421811869706667309789303776520410787883837436838659963707110742181211629");
+    BigInt expected2("-9519604441026697154840321303454275246551311007300714876688669951960444102657365964490755017713112131227099758759296201154505809358130460096934739075501771311213098051");
     assert(num3-num4 == expected2);
     BigInt num5("71311007300714876688669951960444102669715484032130345427524655138867890893197201411522913463688717960921898019494119559150490921095088152386448283120630877367300996091750197750389652106796057638384067568276792218642619756161838094338476170470581645852036305042887575891541065808607552399123930385521914333389668342420684974786564569494856176035326322058077805659331026192708460314150258592864177116725943603718461857357598351152301645904403697613233287231227125684710820209725157101726931323469678542580656697935045997268352998638215525166389437335543602135433229604645318478604952148193555853611059596230656");
     BigInt num6("-11007300714876688669951960444102669715484032130345427524655138867890893197201411522913463688717960921898019494119559150490921095088152386448283120630877367300996091750197750389652106796057638384067568276792218642619756161838094338476170470581645852036305042887575891541065808607552399123930385521914333389668342420684974786564569494856176035326322058077805659331026192708460314150258592864177116725943603718461857357598351152301645904403697613233287231227125684710820209725");
@@ -43,11 +70,115 @@ static void TestDivision() {
     BigInt num4("34157498571749359831543983514538975347897398415");
     BigInt expected2("29053213");
     BigInt result2 = (num3 / num4).first;
+    BigInt num5 = BigInt("98765432123456789").binaryPower(BigInt("700"));
+    BigInt num6 = BigInt("1234567891011121314").binaryPower(BigInt("300"));
+    BigInt num7("123456789");
+    std::pair<BigInt, BigInt> result3 = (num5 * num6 + num7) / num6;
+    assert(result3.first == num5);
+    assert(result3.second == num7);
     std::cout << "Division complete" << std::endl;
 }
 
 
 
+// xorshift64, deterministic so failures reproduce
+static void fillRandom(std::vector<Limb>& limbs, Limb& seed) {
+    for (Limb& x : limbs) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        x = seed;
+    }
+}
+
+static void TestBarrett() {
+    BigInt m = BigInt("10").binaryPower(BigInt("100")) + BigInt("6");
+    BigInt p = BigInt("2").binaryPower(BigInt("127")) - BigInt("1");
+    BigInt a = BigInt("3").binaryPower(BigInt("2000"));
+    BarrettContext even(m.magnitude()), odd(p.magnitude());
+    assert(a.reduce(even) == a % m);
+    assert((BigInt() - a).reduce(even) == m - a % m);
+    assert(BigInt().reduce(even) == BigInt());
+    assert(a.powMod(BigInt("5"), even) == a.binaryPower(BigInt("5")) % m);
+    assert(a.powMod(p, odd) == a.powMod(p, MontgomeryContext(p.magnitude())));
+
+    std::vector<Limb> num(3000), den(1200);
+    Limb seed = 2463534242ULL;
+    fillRandom(num, seed);
+    fillRandom(den, seed);
+    den.back() >>= 5;
+    for (size_t an : { num.size(), den.size() + 400 }) {
+        size_t qn = an - den.size() + 1;
+        std::vector<Limb> q1(qn), r1(den.size()), q2(qn), r2(den.size());
+        mpn::divRemBasecase(q1.data(), r1.data(), num.data(), an, den.data(), den.size());
+        mpn::divRemNewton(q2.data(), r2.data(), num.data(), an, den.data(), den.size());
+        assert(q1 == q2 && r1 == r2);
+    }
+    std::cout << "Barrett complete" << std::endl;
+}
+
+static void TestCompoundAssignment() {
+    BigInt a("-98765432109876543210987654321");
+    BigInt b("123456789012345678901234567890123456789");
+    BigInt x = a;
+    x += b;
+    assert(x == a + b);
+    x -= b;
+    assert(x == a);
+    x *= b;
+    assert(x == a * b);
+    x %= a;
+    assert(x == BigInt("0"));
+    x = b;
+    x <<= 130;
+    assert(x == b * BigInt("2").binaryPower(BigInt("130")));
+    x >>= 130;
+    assert(x == b);
+    x -= x;
+    assert(x == BigInt::zero());
+    assert(BigInt(a) - BigInt(b) == a - b);
+    assert(a - BigInt(b) == a - b);
+    assert(BigInt(b) * a == b * a);
+    BigInt moved(std::move(x = b));
+    assert(moved == b && x == BigInt::zero());
+    std::cout << "CompoundAssignment complete" << std::endl;
+}
+
+static void TestLazyExpression() {
+    BigInt a("-98765432109876543210987654321");
+    BigInt b("123456789012345678901234567890123456789");
+    BigInt c = b.binaryPower(BigInt("20"));
+    BigInt x = lazy(a) + lazy(b) * 3 - (lazy(c) << 70);
+    assert(x == a + b * BigInt("3") - (c << 70));
+    (lazy(c) * -5 + (lazy(a) << 200) - b).evaluateInto(x);
+    assert(x == (a << 200) - c * BigInt("5") - b);
+    x = a;
+    (lazy(x) * 7 - x).evaluateInto(x);
+    assert(x == a * BigInt("6"));
+    BigInt zero = lazy(b) * 4 - (lazy(b) << 2);
+    assert(zero == BigInt::zero());
+    std::cout << "LazyExpression complete" << std::endl;
+}
+
+static void TestCpuKernels() {
+    const mpn::KernelTable& kernels = mpn::kernels();
+    Limb seed = 88172645463325252ULL;
+    for (size_t n = 1; n <= 37; ++n) {
+        std::vector<Limb> a(n + 1), b(n), r(n), expected(n);
+        fillRandom(a, seed);
+        fillRandom(b, seed);
+        if (n % 3 == 0) std::fill(b.begin(), b.end(), ~Limb(0));
+        assert(kernels.addN(r.data(), a.data(), b.data(), n) == mpn::generic::addN(expected.data(), a.data(), b.data(), n) && r == expected);
+        assert(kernels.subN(r.data(), b.data(), a.data(), n) == mpn::generic::subN(expected.data(), b.data(), a.data(), n) && r == expected);
+        assert(kernels.mul1(r.data(), a.data(), n, seed) == mpn::generic::mul1(expected.data(), a.data(), n, seed) && r == expected);
+        assert(kernels.addMul1(r.data(), a.data(), n, ~Limb(0)) == mpn::generic::addMul1(expected.data(), a.data(), n, ~Limb(0)) && r == expected);
+        assert(kernels.subMul1(r.data(), b.data(), n, seed) == mpn::generic::subMul1(expected.data(), b.data(), n, seed) && r == expected);
+        assert(kernels.lshift(r.data(), a.data(), n, 13) == mpn::generic::lshift(expected.data(), a.data(), n, 13) && r == expected);
+        assert(kernels.rshift(r.data(), a.data() + 1, n, 51) == mpn::generic::rshift(expected.data(), a.data() + 1, n, 51) && r == expected);
+    }
+    std::cout << "CpuKernels (" << kernels.name << ") complete" << std::endl;
+}
+
 static void TestMultiplyColumn() {
     BigInt num1("755448463632906992385101029320009013087253313291789021152027218998448");
     BigInt num2("160573471658242280756536120561682786392883229544855414159024150717940378043659686263802057425853288220405823640532697327109845085958994515109620015715798783541864598136943626838242447001302541472010703078935546979992053541928361039587688286");
@@ -78,9 +209,71 @@ static void TestMultiplyKaratsuba() {
     BigInt num6("-6789");
     BigInt expected3("83810205");
     assert(num5.karatsuba(num5,num6) == expected3);
+    BigInt num7 = BigInt("3141592653589793238462643383279").binaryPower(BigInt("1500"));
+    BigInt num8 = BigInt("-2718281828459045235360287471352").binaryPower(BigInt("1101"));
+    BigInt product = num7.karatsuba(num7, num8);
+    assert((product / num8).first == num7);
+    assert(product % num8 == BigInt("0"));
     std::cout << "Karatsuba complete" << std::endl;
 }
 
+static void TestMultiplyNtt() {
+    std::vector<Limb> a(3000), b(2500);
+    Limb seed = 88172645463325252ULL;
+    fillRandom(a, seed);
+    fillRandom(b, seed);
+    a[0] = b[0] = ~Limb(0);
+    std::vector<Limb> expected(a.size() + b.size()), result(a.size() + b.size());
+    mpn::mulBasecase(expected.data(), a.data(), a.size(), b.data(), b.size());
+    mpn::mulNtt(result.data(), a.data(), a.size(), b.data(), b.size());
+    assert(result == expected);
+    std::vector<Limb> expectedSquare(2 * a.size()), square(2 * a.size());
+    mpn::mulBasecase(expectedSquare.data(), a.data(), a.size(), a.data(), a.size());
+    mpn::mulNtt(square.data(), a.data(), a.size(), a.data(), a.size());
+    assert(square == expectedSquare);
+    std::cout << "MultiplyNtt complete" << std::endl;
+}
+
+static void TestParallelMultiply() {
+    BigInt a = BigInt("3").binaryPower(BigInt("200000"));
+    BigInt b = BigInt("7").binaryPower(BigInt("600000"));
+    BigInt toom = a * (a + BigInt::one());
+    BigInt ntt = b * (b - a);
+    BigInt quary = BigInt("12346").quaryPower(20000, 3);
+    BigInt::setMaxThreads(4);
+    assert(a * (a + BigInt::one()) == toom);
+    assert(b * (b - a) == ntt);
+    assert(BigInt("12346").quaryPower(20000, 3) == quary);
+    BigInt::setMaxThreads(1);
+    std::cout << "ParallelMultiply complete" << std::endl;
+}
+
+static void TestDecimalConversion() {
+    BigInt ten("10");
+    BigInt power = ten.binaryPower(BigInt("5000"));
+    std::string nines((power - BigInt("1")).toString());
+    assert(nines == std::string(5000, '9'));
+    assert(power.toString() == "1" + std::string(5000, '0'));
+    BigInt big = BigInt("-3").binaryPower(BigInt("30001"));
+    std::string str = big.toString();
+    assert(str[0] == '-' && str.size() == 14316);
+    assert(BigInt(str) == big);
+    assert(BigInt(str.substr(1)) + big == BigInt("0"));
+    char buffer[8];
+    char* end = BigInt("-1234567").toChars(buffer, buffer + sizeof(buffer));
+    assert(std::string(buffer, end) == "-1234567");
+    bool thrown = false;
+    try {
+        BigInt("123456789").toChars(buffer, buffer + sizeof(buffer));
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(BigInt("-0").toString() == "0");
+    std::cout << "DecimalConversion complete" << std::endl;
+}
+
 static void TestGCD() {
     BigInt num1("241345");
     BigInt num2("6545");
@@ -132,6 +325,33 @@ static void TestExtendedGCD() {
     std::cout << "extendedGCD complete" << std::endl;
 }
 
+static void TestModInverse() {
+    assert(BigInt("17").modInverse(BigInt("3120")) == BigInt("2753"));
+    BigInt m = (BigInt::one() << 521) - BigInt::one();
+    BigInt a = BigInt("3").binaryPower(BigInt("300"));
+    BigInt inverse = a.modInverse(m);
+    assert(inverse == BigInt("4511568762141849490910250650775517155936014342524581161801009921640446713173144962843678202522474828243196383921476532633083052555630256103635361088046028128"));
+    assert((a * inverse) % m == BigInt::one());
+    assert((BigInt::zero() - a).modInverse(m) == m - inverse);
+    bool thrown = false;
+    try {
+        BigInt("6").modInverse(BigInt("9"));
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    BigInt k("12345678901234567");
+    BigInt x = ((BigInt::one() << 300) + BigInt("7")) * k;
+    BigInt y = BigInt("3").binaryPower(BigInt("150")) * k;
+    assert(x.GCD(y) == k);
+    auto e = x.extendedGCD(x, y);
+    assert(e.first == k);
+    assert(x * e.second.first + y * e.second.second == k);
+    std::cout << "ModInverse complete" << std::endl;
+}
+
 static void TestShiftLeft() {
     BigInt num1("12345");
     BigInt result1 = num1 << 12;
@@ -167,6 +387,24 @@ static void TestShiftRight() {
     std::cout << "TestShiftRight complete" << std::endl;
 }
 
+static void TestBitwise() {
+    BigInt a("-123456789012345678901234567890");
+    BigInt b("98765432109876543210987654321987");
+    assert((a & b) == BigInt("98723264769194650204779629810946"));
+    assert((a | b) == BigInt("-81289448330452672693210056849"));
+    assert((a ^ b) == BigInt("-98804554217525102877472839867795"));
+    assert(~a == BigInt("123456789012345678901234567889"));
+    assert(~~b == b);
+    BigInt word("-18446744073709551616");
+    assert(((BigInt::zero() - b) & word) == BigInt("-98765432109878622143169691648000"));
+    assert((word | BigInt::zero()) == word);
+    assert((b ^ b) == BigInt::zero());
+    assert(a.bitLength() == 97 && a.popCount() == 54);
+    assert(!a.testBit(0) && a.testBit(1) && !a.testBit(70) && a.testBit(1000));
+    assert(((BigInt::one() << 100000) >> 99999) == BigInt::two());
+    std::cout << "TestBitwise complete" << std::endl;
+}
+
 static void TestBinaryPow() {
     BigInt num1("12346");
     BigInt num2("1424");
@@ -198,6 +436,279 @@ static void TestQuaryPow() {
     BigInt expected3("15646654121770304976662012040849937172807909943730409674392323559521235236964904887045036126063629407387312669552004487427607075996620736833687512883815412676716078845964924113456790341701983702019321358598188925375203860818977698083638701830871114649514107909717841368374538883082140003121679418324180821621579551396229349393495197848477104999391018847490706878971085928834782198309838781417229647765695597752172300423937279301231075790705803905281786320172037847712762742302592743564157959855765569588504795412386521800025129924713199442302661304294159826780248337042594774407982391451004544764879939789254256569106342246231291343004155731428510290452076429131630622864157592288456878728165452782893236851714696161493770999660100325066607349556899900723948807234886099846273269994940237904504647125221993768287563254039571945170449258024128840314451161839764094786043212222632905897795828477940798720757677110175307091539940508466370685109809248883131323679314909086394326965638828549741458916969111311212981212359610546693121016207429044624570339979245525650933048518951465300832182570077516168014271088977916803690702285118437838605149024652554699947340032287966291794063933142411003664421518961225468789184552004445564578042162982863009552544179261013384819315982502094520418877099895144609176488573675857229706415906773747477953843278925262327376878807923896189084890090820846681191922438144907655137420176836133391455522360966698232326515251521747773396733434395780196049508652707822910083158083688273971403764377321941135789417876712697150649020156989133312560145611427301430949186708699304968855636520677364626418362854266092978641382994707929564002210730364547856778374279495105172226694886090713903547272703058251532219587494762173426745475636023823570547263794118698717644640041364717337938226684987368198750353902780227098956964560071710134670552208169043766652439580364450215347413307722153275967117734520766766853325807700224208744414137609395037985031698613764158252117570281315909773192910369450744484942786651444341824671926735764716951613290805853774761946029961811861635365445756350414842941615672131162553135609385180472215220076116180501887228343526548177851765924504050466508719696134132601893078109433173524370810967972537710319160240240585198261980086424675012130062620659786754423390605097775360622706352969935847430867126895206349615810151542813411656923688586383492326562850912428539179034631202333252023136090206937233992034151937089807405101819348291706159289556956889360317706563213012280766294743817522129401380962804213985062310857995728034607078894436218782868569896368936052581053260035416406989347412636716660784145356489489393393305819350825005735278205883932882776316600511684364775498592136445720007819708210121172139254083263550826347227973469114945517513008996999991408642695217071640538237339917301957921215837459594098025924057426985195230664885648644089974873968968531954814033921");
     BigInt result3 = num5.quaryPower(512, 4);
     assert(result3 == expected3);
+    BigInt base = BigInt("-98765432109876543210987654321");
+    BigInt square = base * base;
+    BigInt expected4 = square.binaryPower(BigInt("512")) * base;
+    assert(base.quaryPower(1025, 2) == expected4);
+    assert(base.quaryPower(1025, 2) == expected4);              // from the cached base^1024
+    BigInt::clearPowerCache();
+    assert(base.quaryPower(1025, 2) == expected4);
+    assert(base.quaryPower(1025, 3) == expected4);
+    assert(base.power(1025) == expected4);
+    BigInt even = base << 77;
+    assert(even.quaryPower(300, 7) == base.power(300) << 23100);
+    assert(BigInt("0").quaryPower(0, 5) == BigInt("1"));
+    assert(BigInt("-1").binaryPower(BigInt("2").binaryPower(BigInt("100")) + BigInt("1")) == BigInt("-1"));
+    bool thrown = false;
+    try {
+        BigInt("3").quaryPower(10, 1);
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+static void TestRoots() {
+    BigInt big = BigInt("10").binaryPower(BigInt("100"));
+    assert(big.isqrt() == BigInt("10").binaryPower(BigInt("50")));
+    std::pair<BigInt, BigInt> r = (big - BigInt("1")).isqrtRem();
+    assert(r.first == BigInt("10").binaryPower(BigInt("50")) - BigInt("1"));
+    assert(r.second == BigInt("2") * r.first);
+    BigInt seven = BigInt("7").binaryPower(BigInt("1000"));
+    r = (seven.binaryPower(BigInt("3")) + BigInt("5")).irootRem(3);
+    assert(r.first == seven && r.second == BigInt("5"));
+    r = BigInt("-30").irootRem(3);
+    assert(r.first == BigInt("-3") && r.second == BigInt("-3"));
+    assert(BigInt("123456789").iroot(1) == BigInt("123456789"));
+    assert(BigInt("0").isqrt() == BigInt("0"));
+    BigInt base;
+    unsigned exponent = 0;
+    assert(BigInt("12").binaryPower(BigInt("15")).isPerfectPower(base, exponent));
+    assert(base == BigInt("12") && exponent == 15);
+    assert(BigInt("2").binaryPower(BigInt("60")).isPerfectPower(base, exponent));
+    assert(base == BigInt("2") && exponent == 60);
+    assert(BigInt("-8").isPerfectPower(base, exponent));
+    assert(base == BigInt("-2") && exponent == 3);
+    assert(!BigInt("-16").isPerfectPower());
+    assert(!(BigInt("3").binaryPower(BigInt("2000")) + BigInt("2")).isPerfectPower());
+    assert(BigInt("12").binaryPower(BigInt("100003")).isPerfectPower(base, exponent));
+    assert(base == BigInt("12") && exponent == 100003);
+    // every prime exponent up to the length is screened without a pass over the limbs
+    BigInt huge = (BigInt("1") << (1 << 20)) + BigInt("3");
+    auto start = std::chrono::steady_clock::now();
+    assert(!huge.isPerfectPower());
+    assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    bool thrown = false;
+    try {
+        BigInt("-4").isqrt();
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "Roots complete" << std::endl;
+}
+
+static void TestPrimes() {
+    BigInt two("2");
+    assert(!BigInt("-7").isProbablePrime() && !BigInt("1").isProbablePrime());
+    assert(BigInt("2").isProbablePrime() && BigInt("8191").isProbablePrime());
+    assert(!BigInt("3215031751").isProbablePrime());             // strong pseudoprime to bases 2, 3, 5, 7
+    assert(!BigInt("3825123056546413051").isProbablePrime());    // ... and to every base up to 23
+    assert(!BigInt("5459").isProbablePrime() && !BigInt("161027").isProbablePrime());  // strong Lucas
+    BigInt mersenne = two.binaryPower(BigInt("521")) - BigInt("1");
+    assert(mersenne.isProbablePrime(4));
+    assert(!(mersenne * mersenne).isProbablePrime());
+    assert(!(two.binaryPower(BigInt("523")) - BigInt("1")).isProbablePrime());
+    assert(BigInt("0").nextPrime() == BigInt("2"));
+    assert(BigInt("7").nextPrime() == BigInt("11"));
+    assert(BigInt("1000000").nextPrime() == BigInt("1000003"));
+    BigInt big = BigInt("10").binaryPower(BigInt("100"));
+    assert(big.nextPrime() == big + BigInt("267"));
+    std::mt19937_64 rng(17);
+    BigInt prime = BigInt::randomPrime(256, rng);
+    assert(prime.bitLength() == 256 && prime.isProbablePrime(8));
+    std::cout << "Primes complete" << std::endl;
+}
+
+static void TestPowMod() {
+    BigInt two("2");
+    BigInt p = two.binaryPower(BigInt("521")) - BigInt("1");
+    BigInt e = BigInt("10").binaryPower(BigInt("40")) + BigInt("7");
+    BigInt expected1("2940799015610611506619277061529328418569870105144398694739791495664842484290507612852066053775931476354973592556921247408606086867423052216755357871500368621");
+    assert(p.powMod(BigInt("3"), e, p) == expected1);
+    assert(p.powModConstantTime(BigInt("3"), e, p) == expected1);
+    assert(BigInt("3").powMod(e, MontgomeryContext(p.magnitude())) == expected1);
+    BigInt even = BigInt("10").binaryPower(BigInt("60"));
+    BigInt e2 = two.binaryPower(BigInt("200")) + BigInt("3");
+    assert(even.powMod(BigInt("-123456789"), e2, even) == BigInt("59970958316863248721921443076270415538361015561295260052691"));
+    assert(p.powMod(p, BigInt("0"), BigInt("1")) == BigInt("0"));
+    assert(p.powModConstantTime(BigInt("5"), BigInt("0"), p) == BigInt("1"));
+    assert(BigInt("987654321").myPow(BigInt("12345"), BigInt("1000000007")) == BigInt("142100376"));
+    std::cout << "PowMod complete" << std::endl;
+}
+
+static void TestPowModBatch() {
+    BigInt p = BigInt("2").binaryPower(BigInt("127")) - BigInt("1");
+    BigInt q = BigInt("1000000007");
+    BigInt even = BigInt("10").binaryPower(BigInt("30"));
+    BigInt big = BigInt("2").binaryPower(BigInt("521")) - BigInt("1");
+    const size_t count = 11;
+    BigInt bases[count], exponents[count], moduli[count], results[count];
+    for (size_t i = 0; i < count; ++i) {
+        bases[i] = BigInt("-98765432123456789").binaryPower(BigInt((long long)i + 1));
+        exponents[i] = BigInt("65537") * BigInt((long long)i);
+        const BigInt* mods[] = { &p, &q, &even, &big };
+        moduli[i] = *mods[i % 4];
+    }
+    moduli[7] = BigInt() - q;
+    BigInt::powModBatch(bases, exponents, moduli, results, count);
+    for (size_t i = 0; i < count; ++i) {
+        assert(results[i] == bases[i].powMod(bases[i], exponents[i], moduli[i]));
+    }
+
+    MontgomeryContext ctx(p.magnitude());
+    BigInt::powModBatch(bases, exponents, ctx, results, count);
+    for (size_t i = 0; i < count; ++i) {
+        assert(results[i] == bases[i].powMod(exponents[i], ctx));
+    }
+    std::cout << "PowModBatch complete" << std::endl;
+}
+
+static void TestSerialization() {
+    BigInt values[] = { BigInt(), BigInt("-1"), BigInt("18446744073709551616"),
+        BigInt("-3").binaryPower(BigInt("4001")) };
+    for (const BigInt& value : values) {
+        std::vector<unsigned char> bytes = value.serialize();
+        assert(bytes.size() == value.serializedSize());
+        assert(BigInt::deserialize(bytes.data(), bytes.data() + bytes.size()) == value);
+    }
+    std::vector<unsigned char> bytes = BigInt("-18446744073709551617").serialize();
+    const unsigned char expected[] = { 'B', 'I', 'G', 'I', 1, 1, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0,
+        1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0 };
+    assert(bytes.size() == sizeof(expected) && std::equal(bytes.begin(), bytes.end(), expected));
+
+    bool threw = false;
+    try {
+        BigInt::deserialize(bytes.data(), bytes.data() + bytes.size() - 1);
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // a view over an aligned buffer, as a mapped file would give
+    BigInt a = values[3];
+    BigInt b = BigInt("7").binaryPower(BigInt("1500"));
+    std::vector<Limb> buffer(a.serializedSize() / sizeof(Limb));
+    unsigned char* first = reinterpret_cast<unsigned char*>(buffer.data());
+    a.serialize(first, first + a.serializedSize());
+    BigIntView view = BigIntView::fromSerialized(first, first + a.serializedSize());
+    assert(view.data() == buffer.data() + 2 && view == a && view.negative());
+    assert(view + b == a + b);
+    assert(b - view == b - a);
+    assert(view * b == a * b);
+    assert((view / b).first == (a / b).first && view % b == a % b);
+    assert((b / view).second == (b / a).second && view < b);
+    assert(view.toString() == a.toString());
+    assert(BigInt(view) == a);
+    std::cout << "Serialization complete" << std::endl;
+}
+
+static void TestDecimalStream() {
+    BigInt big = BigInt("-3").binaryPower(BigInt("400001"));
+    std::string text = big.toString();
+    std::ostringstream out;
+    big.writeDecimal(out);
+    assert(out.str() == text);
+    std::string blocks;
+    size_t calls = 0;
+    big.writeDecimal([&](const char* s, size_t n) { blocks.append(s, n); ++calls; });
+    assert(blocks == text && calls > 1);
+    std::ostringstream padded;
+    (BigInt("10").binaryPower(BigInt("5000")) + BigInt("7")).writeDecimal(padded);
+    assert(padded.str() == "1" + std::string(4999, '0') + "7");
+
+    std::istringstream in("  " + text + "\n");
+    assert(BigInt::readDecimal(in) == big);
+    // a source handing out a few characters per call, as a pipe or socket would
+    size_t pos = 0;
+    BigInt parsed = BigInt::readDecimal([&](char* buffer, size_t size) {
+        size_t n = std::min(std::min(size, size_t(777)), text.size() - pos);
+        std::copy(text.begin() + pos, text.begin() + pos + n, buffer);
+        pos += n;
+        return n;
+    });
+    assert(parsed == big);
+    std::istringstream zeros("-000000000000000000000000000000");
+    BigInt zero = BigInt::readDecimal(zeros);
+    assert(zero == BigInt() && zero.toString() == "0");
+
+    const char* invalid[] = { "", "-", "12 34", "12a", "- 5" };
+    for (const char* s : invalid) {
+        std::istringstream bad(s);
+        bool threw = false;
+        try {
+            BigInt::readDecimal(bad);
+        }
+        catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "DecimalStream complete" << std::endl;
+}
+
+static void TestInstrumentation() {
+    instrumentation::reset();
+    BigInt a = BigInt("3").binaryPower(BigInt("5000"));
+    BigInt b = BigInt("7").binaryPower(BigInt("4000"));
+    BigInt c = (a * b / b).first;
+    assert(c == a);
+    std::string text = c.toString();
+    instrumentation::Snapshot s = instrumentation::snapshot();
+#ifdef BIGINT_INSTRUMENT
+    assert(s.probes[instrumentation::Multiply].calls >= 1);
+    assert(s.probes[instrumentation::MulKaratsuba].calls >= 1);
+    assert(s.probes[instrumentation::Divide].calls == 1);
+    assert(s.probes[instrumentation::Power].calls == 2);
+    assert(s.probes[instrumentation::ToString].limbs == a.magnitude().size());
+    assert(s.allocation.allocations > 0 && s.allocation.peakBytes > 0);
+    assert(s.toJson().find("\"mulKaratsuba\": {\"calls\": ") != std::string::npos);
+    assert(s.toText().find("divide") != std::string::npos);
+    // the transform buffers of an NTT-sized product are counted, not just the product itself
+    BigInt x = (BigInt("1") << 640000) - BigInt("1"), y = (BigInt("1") << 650000) - BigInt("3");
+    instrumentation::reset();
+    BigInt xy = x * y;
+    s = instrumentation::snapshot();
+    assert(s.probes[instrumentation::MulNtt].calls == 1);
+    assert(s.allocation.peakBytes > int64_t(2 * xy.magnitude().size() * sizeof(Limb)));
+    instrumentation::reset();
+    assert(instrumentation::threadSnapshot().probes[instrumentation::Multiply].calls == 0);
+#else
+    assert(s.probes[instrumentation::Multiply].calls == 0 && s.allocation.allocations == 0);
+    assert(s.toJson().find("\"probes\": {}") != std::string::npos);
+#endif
+    std::cout << "Instrumentation complete" << std::endl;
+}
+
+static void TestMultiPow() {
+    BigInt p = BigInt("2").binaryPower(BigInt("127")) - BigInt("1");
+    BigInt g("3"), h("-12345678901234567890");
+    BigInt a = BigInt("10").binaryPower(BigInt("30")) + BigInt("11");
+    BigInt b = BigInt("7").binaryPower(BigInt("40"));
+    BigInt expected = g.powMod(g, a, p) * h.powMod(h, b, p) % p;
+    assert(BigInt::multiPowMod(g, a, h, b, p) == expected);
+    BigInt even = BigInt("10").binaryPower(BigInt("25"));
+    assert(BigInt::multiPowMod(g, a, h, b, even) == g.powMod(g, a, even) * h.powMod(h, b, even) % even);
+    std::vector<BigInt> bases, exponents;
+    BigInt product("1");
+    for (int i = 0; i < 200; ++i) {                              // enough terms for Pippenger
+        bases.push_back(BigInt((long long)(i * 7919 + 2)));
+        exponents.push_back(a + BigInt((long long)(i * i)));
+        product = product * bases[i].powMod(bases[i], exponents[i], p) % p;
+    }
+    assert(BigInt::multiPowMod(bases.data(), exponents.data(), bases.size(), p) == product);
+    assert(BigInt::multiPowMod(bases.data(), exponents.data(), 0, p) == BigInt("1"));
+    FixedBasePowMod fixedBase(g, p, 128, 4, 3);
+    assert(fixedBase.maxExponentBits() >= 128);
+    assert(fixedBase.pow(a) == g.powMod(g, a, p));
+    assert(fixedBase.pow(BigInt("0")) == BigInt("1"));
+    assert(fixedBase.pow(p * p) == g.powMod(g, p * p, p));      // past the table
+    FixedBasePowMod evenBase(h, even, 200);
+    assert(evenBase.pow(b) == h.powMod(h, b, even));
+    std::cout << "MultiPow complete" << std::endl;
 }
 
 static void TestMontgomery() {
@@ -209,20 +720,93 @@ static void TestMontgomery() {
     BigInt r1, r2;
     BigInt result1 = num1.montgomeryProd(num1, num2, num3, r1, r, r2);
     assert(result1 == expected1);
+    assert(r1 * num3 % r == r - BigInt("1"));
+    assert(r2 == r * r % num3);
+
+    BigInt p = BigInt("2").binaryPower(BigInt("521")) - BigInt("1");
+    BigInt a = BigInt("3").binaryPower(BigInt("400"));
+    BigInt b = BigInt("-7").binaryPower(BigInt("301"));
+    MontgomeryContext ctx(p.magnitude());
+    BigInt aMont = a.toMontgomery(ctx);
+    assert(aMont.fromMontgomery(ctx) == a % p);
+    BigInt product = aMont.montgomeryMul(b.toMontgomery(ctx), ctx).fromMontgomery(ctx);
+    assert(product == p - a * BigInt("7").binaryPower(BigInt("301")) % p);
     std::cout << "Montgomery complete" << std::endl;
 }
 
+static void TestFixedWidth() {
+    // 2^127 = 1 modulo the Mersenne prime 2^127 - 1, checked by the compiler with a short exponent
+    constexpr BigUInt<128> m127 = ~BigUInt<128>() >> 1;
+    constexpr FixedMontgomery<128> ctx127(m127);
+    static_assert(ctx127.pow(BigUInt<128>(2), BigUInt<128>(127)) == BigUInt<128>(1), "2^127 mod 2^127 - 1");
+    // P-256 prime; a full-width exponent is too many steps for compile-time evaluation
+    constexpr BigUInt<256> p = BigUInt<256>::fromHex("ffffffff00000001000000000000000000000000ffffffffffffffffffffffff");
+    const FixedMontgomery<256> ctx(p);
+    assert(ctx.pow(BigUInt<256>(3), p - BigUInt<256>(1)) == BigUInt<256>(1));
+    static_assert(BigUInt<128>::fromDecimal("340282366920938463463374607431768211455") == ~BigUInt<128>(), "2^128 - 1");
+
+    BigInt p256 = p.toBigInt();
+    assert(p256 == BigInt("2").binaryPower(BigInt("256")) - BigInt("2").binaryPower(BigInt("224")) +
+        BigInt("2").binaryPower(BigInt("192")) + BigInt("2").binaryPower(BigInt("96")) - BigInt("1"));
+    BigInt r256 = BigInt("2").binaryPower(BigInt("256"));
+    BigInt a = BigInt("3").binaryPower(BigInt("160")), b = BigInt("7").binaryPower(BigInt("90"));
+    BigUInt<256> fa(a), fb(b);
+    assert((fa + fb).toBigInt() == (a + b) % r256);
+    assert((fb - fa).toBigInt() == (b - a + r256) % r256);
+    assert((fa * fb).toBigInt() == a * b % r256);
+    assert(mulFull(fa, fb).toBigInt() == a * b);
+    assert((fa << 100).toBigInt() == (a << 100) % r256);
+    assert((fa >> 70).toBigInt() == a >> 70);
+    assert(fb < fa && fa.bitLength() == 254 && compare(fa, fa) == 0);
+    assert(ctx.pow(fa, fb).toBigInt() == p256.powMod(a, b, p256));
+
+    BigInt m = BigInt("2").binaryPower(BigInt("2048")) - BigInt("159");
+    BigUInt<2048> fm(m), fx(a * b);
+    FixedMontgomery<2048> big(fm);
+    assert(big.pow(fx, fb).toBigInt() == m.powMod(a * b, b, m));
+    assert(big.fromMontgomery(big.mul(big.toMontgomery(fx), big.toMontgomery(fx))).toBigInt() == a * b * a * b % m);
+
+    bool thrown = false;
+    try {
+        BigUInt<64> tooWide(r256);
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "FixedWidth complete" << std::endl;
+}
+
 static void startTests() {
+    TestSmallValues();
     TestSum();
     TestSub();
     TestDivision();
+    TestBarrett();
+    TestCompoundAssignment();
+    TestLazyExpression();
+    TestCpuKernels();
     TestMultiplyColumn();
     TestMultiplyKaratsuba();
+    TestMultiplyNtt();
+    TestParallelMultiply();
+    TestDecimalConversion();
     TestGCD();
     TestExtendedGCD();
+    TestModInverse();
     TestShiftLeft();
     TestShiftRight();
+    TestBitwise();
     TestBinaryPow();
     TestQuaryPow();
+    TestRoots();
+    TestPrimes();
+    TestPowMod();
+    TestPowModBatch();
+    TestMultiPow();
     TestMontgomery();
+    TestSerialization();
+    TestDecimalStream();
+    TestInstrumentation();
+    TestFixedWidth();
 }
\ No newline at end of file
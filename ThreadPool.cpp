@@ -0,0 +1,203 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+// Products whose shorter operand reaches this many limbs hand their independent sub-products
+// to the thread pool, once more than one thread is allowed.
+#ifndef BIGINT_PARALLEL_THRESHOLD
+#define BIGINT_PARALLEL_THRESHOLD 1024
+#endif
+
+namespace mpn {
+
+    // Work-stealing pool. Every worker owns a deque, runs its newest task first and steals the
+    // oldest task of another queue when its own is empty; threads outside the pool push to a
+    // shared queue. The calling thread counts as one of the `threads`.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned threads) : queues(threads), queued(0), stopping(false) {
+            for (unsigned i = 1; i < threads; ++i) {
+                workers.emplace_back([this, i] { workerLoop(i); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t size() const { return queues.size(); }
+
+        void push(std::function<void()> task) {
+            Queue& queue = queues[ownQueue()];
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                queue.tasks.push_back(std::move(task));
+            }
+            queued.fetch_add(1);
+            {
+                std::lock_guard<std::mutex> guard(sleepLock);
+            }
+            wake.notify_one();
+        }
+
+        // Runs one queued task, its own newest first, else the oldest it can steal.
+        bool runOne() {
+            std::function<void()> task;
+            size_t own = ownQueue();
+            for (size_t i = 0; i < queues.size() && !task; ++i) {
+                Queue& queue = queues[(own + i) % queues.size()];
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if (queue.tasks.empty()) continue;
+                if (i == 0) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+            }
+            if (!task) return false;
+            queued.fetch_sub(1);
+            task();
+            return true;
+        }
+
+    private:
+        struct Queue {
+            std::mutex lock;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<Queue> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> queued;
+        std::mutex sleepLock;
+        std::condition_variable wake;
+        bool stopping;
+
+        // Queue 0 is shared by every thread outside the pool.
+        static size_t& workerIndex() {
+            static thread_local size_t index = 0;
+            return index;
+        }
+
+        static const ThreadPool*& workerPool() {
+            static thread_local const ThreadPool* pool = nullptr;
+            return pool;
+        }
+
+        size_t ownQueue() const {
+            return workerPool() == this ? workerIndex() : 0;
+        }
+
+        void workerLoop(size_t index) {
+            workerPool() = this;
+            workerIndex() = index;
+            for (;;) {
+                if (runOne()) continue;
+                std::unique_lock<std::mutex> lock(sleepLock);
+                wake.wait(lock, [this] { return stopping || queued.load() != 0; });
+                if (stopping) return;
+            }
+        }
+    };
+
+    // Fork-join over a pool; with no pool every task runs inline. wait() runs queued tasks
+    // while the group is unfinished, so nested groups never block a worker, and rethrows the
+    // first exception a task raised.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool* pool) : pool(pool), pending(0) {
+        }
+
+        ~TaskGroup() {
+            while (pending.load() != 0) {
+                if (!pool->runOne()) std::this_thread::yield();
+            }
+        }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        template <class F>
+        void run(F f) {
+            if (pool == nullptr) {
+                f();
+                return;
+            }
+            pending.fetch_add(1);
+            pool->push([this, f] {
+                try {
+                    f();
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> guard(errorLock);
+                    if (!error) error = std::current_exception();
+                }
+                pending.fetch_sub(1);
+            });
+        }
+
+        void wait() {
+            while (pending.load() != 0) {
+                if (!pool->runOne()) std::this_thread::yield();
+            }
+            if (error) std::rethrow_exception(error);
+        }
+
+    private:
+        ThreadPool* pool;
+        std::atomic<size_t> pending;
+        std::mutex errorLock;
+        std::exception_ptr error;
+    };
+
+    struct ParallelState {
+        std::mutex lock;
+        std::unique_ptr<ThreadPool> owned;
+        std::atomic<ThreadPool*> pool;
+    };
+
+    inline ParallelState& parallelState() {
+        static ParallelState state;
+        return state;
+    }
+
+    // Caps the threads the arithmetic may use: 1 (the default) keeps everything on the calling
+    // thread, 0 means one per hardware thread. Not to be called while a product is running.
+    inline void setParallelThreads(unsigned threads) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        ParallelState& state = parallelState();
+        std::lock_guard<std::mutex> guard(state.lock);
+        state.pool.store(nullptr);
+        state.owned.reset(threads > 1 ? new ThreadPool(threads) : nullptr);
+        state.pool.store(state.owned.get());
+    }
+
+    inline unsigned parallelThreads() {
+        ThreadPool* pool = parallelState().pool.load();
+        return pool == nullptr ? 1 : unsigned(pool->size());
+    }
+
+    // The pool to fork n-limb work onto, or null when it should stay on this thread.
+    inline ThreadPool* parallelPool(size_t n) {
+        return n >= BIGINT_PARALLEL_THRESHOLD ? parallelState().pool.load() : nullptr;
+    }
+}